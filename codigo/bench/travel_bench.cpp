@@ -0,0 +1,801 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+#include <string.h>
+#include <unistd.h>
+
+#include "entities/graph.h"
+#include "dataset.h"
+#include "alloc_counter.h"
+#include "graph_versions.h"
+#include "worker_pool.h"
+#include "huge_pages.h"
+#include "edge_stream.h"
+#include "engines.h"
+
+using namespace std;
+
+/** @brief The measurements of one operation on one dataset */
+struct Series {
+    string name;
+    vector<double> micros;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    explicit Series(string name) : name(move(name)) {}
+
+    double mean() const {
+        double sum = 0;
+        for (double m : micros) sum += m;
+        return micros.empty() ? 0 : sum / micros.size();
+    }
+
+    double percentile(double p) const {
+        if (micros.empty()) return 0;
+
+        vector<double> sorted = micros;
+        sort(sorted.begin(), sorted.end());
+
+        size_t rank = (size_t) ((p / 100) * (sorted.size() - 1) + 0.5);
+        return sorted[rank];
+    }
+};
+
+/** @brief The throughput and memory of a pool of worker processes answering widest path queries */
+struct PoolReport {
+    unsigned workers;
+    size_t queries;
+    double seconds;
+
+    /** @brief The memory only the workers hold, on average, and the memory of the parent and workers together */
+    double worker_private_kib;
+    double total_pss_kib;
+    double parent_rss_kib;
+};
+
+/** @brief The measurements taken on one dataset */
+struct DatasetReport {
+    string path;
+    unsigned long nodes = 0, edges = 0;
+
+    /** @brief The bytes held by the graph, leaving out the search state */
+    size_t memory = 0;
+    vector<Series> series;
+    vector<PoolReport> pools;
+
+    /** @brief What the graph's arrays got, taken while the graph and its search state are still alive */
+    HugePageReport huge_pages{};
+
+    /** @brief The size of the edge file and the most nodes a pass over it held at once, with --edge-file */
+    size_t edge_file_bytes = 0;
+    uint64_t peak_frontier = 0;
+};
+
+/** @brief The command line options */
+struct Options {
+    string input_dir = "input";
+    vector<string> files;
+    string json;
+    unsigned queries = 50;
+    unsigned loads = 3;
+    double budget = 5;
+    unsigned long seed = 1;
+    bool check_allocations = false;
+    bool skip_flows = false;
+    unsigned hot_swaps = 0;
+    unsigned workers = 0;
+    NodeOrder order = NodeOrder::FILE;
+    HugePages huge_pages = HugePages::OFF;
+    bool compress = false;
+    bool edge_file = false;
+    bool engines = false;
+    WidestPathEngine widest_engine = WidestPathEngine::AUTO;
+    FlowEngine flow_engine = FlowEngine::AUTO;
+};
+
+/** @brief Whether measure records anything, which it doesn't while warming up */
+static bool measuring = true;
+
+/**
+ * @brief Runs and measures a single call
+ *
+ * @param series The series the measurement is added to
+ * @param f The call
+ */
+template <class F>
+static void measure(Series &series, F &&f) {
+    if (!measuring) {
+        f();
+        return;
+    }
+
+    AllocationStats before = allocation_stats();
+    auto start = chrono::steady_clock::now();
+
+    f();
+
+    auto end = chrono::steady_clock::now();
+    AllocationStats after = allocation_stats();
+
+    series.micros.push_back(chrono::duration<double, micro>(end - start).count());
+    series.allocations += after.count - before.count;
+    series.bytes += after.bytes - before.bytes;
+}
+
+/**
+ * @brief Runs a query for each pair, until every pair is done or the time budget is spent
+ *
+ * The first pair is run once unmeasured, to size the buffers, and is then always measured. With
+ * --check-allocations, the whole pass is run unmeasured first, and then measured again over the same pairs, so
+ * that the measured pass shows what a warm query allocates.
+ *
+ * @param pairs The starting and ending points
+ * @param options The command line options
+ * @param query The query, taking a pair
+ */
+template <class F>
+static void for_each_pair(const vector<pair<unsigned long, unsigned long>> &pairs, const Options &options, F &&query) {
+    auto start = chrono::steady_clock::now();
+    size_t count = 0;
+
+    measuring = false;
+    for (const auto &pair : pairs) {
+        query(pair.first, pair.second);
+        count++;
+
+        if (!options.check_allocations || chrono::duration<double>(chrono::steady_clock::now() - start).count() > options.budget) {
+            break;
+        }
+    }
+    measuring = true;
+
+    if (options.check_allocations) {
+        for (size_t i = 0; i < count; i++) {
+            query(pairs[i].first, pairs[i].second);
+        }
+
+        return;
+    }
+
+    start = chrono::steady_clock::now();
+    for (const auto &pair : pairs) {
+        query(pair.first, pair.second);
+
+        if (chrono::duration<double>(chrono::steady_clock::now() - start).count() > options.budget) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Measures widest path queries while the dataset is loaded again and again in the background
+ *
+ * The reader picks up each new version between queries, as the interface does, so comparing this series with
+ * the steady get_max_capacity_path one shows what swapping costs the queries. The "swap" series is the time
+ * from starting a load until the reader runs on the new version.
+ *
+ * @param path The dataset file
+ * @param pairs The starting and ending points
+ * @param options The command line options
+ * @param report Where the series are added
+ */
+template <class G>
+static void bench_hot_swap(const string &path, const vector<pair<unsigned long, unsigned long>> &pairs, const Options &options,
+                           DatasetReport &report) {
+    using Index = decltype(declval<G>().size());
+
+    Series reading{ "get_max_capacity_path (hot swap)" }, swap{ "swap" };
+
+    GraphVersions versions;
+    versions.publish(load_graph(File(path), options.order), path);
+
+    shared_ptr<const GraphVersion> version;
+    G graph;
+    vector<Index> buffer;
+
+    auto start = chrono::steady_clock::now();
+    auto load_start = start;
+    unsigned started = 0;
+    uint64_t expected = 0;
+
+    for (size_t i = 0; chrono::duration<double>(chrono::steady_clock::now() - start).count() < options.budget; i++) {
+        shared_ptr<const GraphVersion> latest = versions.acquire();
+        if (latest != version) {
+            version = latest;
+            graph = get<G>(latest->graph);
+
+            if (latest->number == expected) {
+                swap.micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - load_start).count());
+            }
+        }
+
+        // The next reload starts once the reader runs on the last one
+        if (version->number >= expected && !versions.is_loading()) {
+            if (started == options.hot_swaps) {
+                break;
+            }
+
+            expected = versions.get_version() + 1;
+            load_start = chrono::steady_clock::now();
+            versions.load_in_background(path, options.order);
+            started++;
+        }
+
+        const auto &[first, second] = pairs[i % pairs.size()];
+        measure(reading, [&]() { graph.get_max_capacity_path(first, second, buffer); });
+    }
+
+    version.reset();
+    graph = G();
+    versions.wait();
+
+    string error = versions.take_error();
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    report.series.insert(report.series.end(), { reading, swap });
+}
+
+/**
+ * @brief Reads a field of /proc/PID/smaps_rollup
+ *
+ * @param pid The process
+ * @param field The name of the field, with its colon
+ * @return The value in KiB, 0 if it can't be read
+ */
+static double read_smaps(pid_t pid, const string &field) {
+    ifstream smaps("/proc/" + to_string(pid) + "/smaps_rollup");
+
+    string line;
+    while (getline(smaps, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return stod(line.substr(field.size()));
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measures widest path queries answered by pools of 1, 2, 4... up to the given number of worker processes
+ *
+ * The workers are forked after the graph is built and share it, so the memory each of them holds privately
+ * should be little more than its search state.
+ *
+ * @param graph The graph
+ * @param pairs The starting and ending points
+ * @param query_micros The mean time of a query in this process
+ * @param options The command line options
+ * @param report Where the results are added
+ */
+template <class G>
+static void bench_workers(G &graph, const vector<pair<unsigned long, unsigned long>> &pairs, double query_micros,
+                          const Options &options, DatasetReport &report) {
+    using Index = decltype(graph.size());
+
+    // Enough queries that forking and warming up are a small part of the time, but that a single worker
+    // still keeps to the time budget
+    size_t count = clamp<size_t>(options.budget * 1e6 / max(query_micros, 1.0), 1, 1000);
+
+    vector<string> requests;
+    while (requests.size() < count) {
+        const auto &[start, end] = pairs[requests.size() % pairs.size()];
+        requests.push_back(to_string(start) + " " + to_string(end));
+    }
+
+    vector<unsigned> sizes;
+    for (unsigned workers = 1; workers < options.workers; workers *= 2) {
+        sizes.push_back(workers);
+    }
+    sizes.push_back(options.workers);
+
+    for (unsigned workers : sizes) {
+        WorkerPool pool(workers, [&graph, path = vector<Index>()](const string &request) mutable {
+            unsigned long start, end;
+            istringstream(request) >> start >> end;
+
+            return to_string(graph.get_max_capacity_path(start, end, path).first);
+        });
+
+        auto begin = chrono::steady_clock::now();
+        pool.run(requests);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        PoolReport pool_report{ workers, requests.size(), seconds, 0, read_smaps(getpid(), "Pss:"), read_smaps(getpid(), "Rss:") };
+        for (pid_t pid : pool.get_pids()) {
+            pool_report.worker_private_kib += (read_smaps(pid, "Private_Clean:") + read_smaps(pid, "Private_Dirty:")) / workers;
+            pool_report.total_pss_kib += read_smaps(pid, "Pss:");
+        }
+
+        report.pools.push_back(pool_report);
+    }
+}
+
+/**
+ * @brief Measures every widest path and maximum flow engine over the same pairs, whichever one AUTO would pick
+ *
+ * The paths and flows they find may differ on ties, but the engines must agree on the capacity of each widest
+ * path and on the dimension of each maximum group. An engine the graph can't run falls back as it would in travel.
+ *
+ * @param graph The graph
+ * @param pairs The starting and ending points
+ * @param options The command line options
+ * @param report Where the series are added
+ */
+template <class G>
+static void bench_engines(G &graph, const vector<pair<unsigned long, unsigned long>> &pairs, const Options &options,
+                          DatasetReport &report) {
+    using Index = decltype(graph.size());
+    using Weight = decltype(graph.get_flow(0));
+
+    // The first engine's answers, which the others are held to
+    map<pair<unsigned long, unsigned long>, Weight> capacities, dimensions;
+    vector<Index> path;
+    vector<tuple<Index, Index, Weight>> flow_path;
+
+    auto check = [](map<pair<unsigned long, unsigned long>, Weight> &answers, unsigned long start, unsigned long end,
+                    Weight answer, const char *engine) {
+        auto [it, first] = answers.insert({ { start, end }, answer });
+        if (!first && it->second != answer) {
+            throw runtime_error(string("the ") + engine + " engine disagrees from " + to_string(start) + " to " + to_string(end));
+        }
+    };
+
+    for (WidestPathEngine engine : { WidestPathEngine::HEAP, WidestPathEngine::BUCKET_QUEUE, WidestPathEngine::DAG_SWEEP }) {
+        set_widest_path_engine(engine);
+        Series series{ string("widest path: ") + engine_name(engine) };
+
+        for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+            Weight capacity = 0;
+            measure(series, [&]() { capacity = graph.get_max_capacity_path(start, end, path).first; });
+            check(capacities, start, end, capacity, engine_name(engine));
+        });
+
+        report.series.push_back(series);
+    }
+    set_widest_path_engine(options.widest_engine);
+
+    if (options.skip_flows) {
+        return;
+    }
+
+    for (FlowEngine engine : { FlowEngine::EDMONDS_KARP, FlowEngine::BLOCKING_FLOW, FlowEngine::CAPACITY_SCALING }) {
+        set_flow_engine(engine);
+        Series series{ string("max flow: ") + engine_name(engine) };
+
+        for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+            measure(series, [&]() { graph.get_path_for_group_of_max_size(start, end, flow_path); });
+
+            Weight dimension = 0;
+            for (const auto &[origin, destination, flow] : flow_path) {
+                if (origin == start && destination != start) {
+                    dimension += flow;
+                }
+            }
+            check(dimensions, start, end, dimension, engine_name(engine));
+        });
+
+        report.series.push_back(series);
+    }
+    set_flow_engine(options.flow_engine);
+}
+
+/**
+ * @brief Measures the meetup and waiting periods answered by a pass over an edge file instead of the graph
+ *
+ * With flows, the file is written again for the maximum group of each pair, and the pass must give what the
+ * graph gives. Without them, it's written once and every edge is followed.
+ *
+ * @param graph The graph
+ * @param pairs The starting and ending points
+ * @param options The command line options
+ * @param report Where the series and the size of the frontier are added
+ */
+template <class G>
+static void bench_edge_file(G &graph, const vector<pair<unsigned long, unsigned long>> &pairs, const Options &options,
+                            DatasetReport &report) {
+    using Index = decltype(graph.size());
+    using Weight = decltype(graph.get_flow(0));
+
+    Series write{ "write edge file" }, stream{ "stream_earliest_meetup" };
+    string path = (filesystem::temp_directory_path() / ("travel_bench_" + to_string(getpid()) + ".edges")).string();
+
+    vector<tuple<Index, Index, Weight>> flow_path;
+    vector<pair<Index, Weight>> expected;
+    vector<pair<uint64_t, uint64_t>> waiting_periods;
+
+    if (options.skip_flows) {
+        measure(write, [&]() { write_edge_stream(graph, path, false); });
+    }
+
+    for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+        if (!options.skip_flows) {
+            graph.get_path_for_group_of_max_size(start, end, flow_path);
+            measure(write, [&]() { write_edge_stream(graph, path, true); });
+        }
+
+        StreamedMeetup result;
+        waiting_periods.clear();
+        measure(stream, [&]() {
+            result = stream_earliest_meetup(path, start, end, [&](uint64_t node, uint64_t duration) {
+                waiting_periods.push_back({ node, duration });
+            });
+        });
+        report.peak_frontier = max(report.peak_frontier, result.peak_frontier);
+
+        if (options.skip_flows) {
+            return;
+        }
+
+        graph.get_waiting_periods(start, end, expected);
+        sort(waiting_periods.begin(), waiting_periods.end());
+
+        bool same = result.earliest_meetup == graph.get_earliest_meetup(start, end) && waiting_periods.size() == expected.size()
+                    && equal(expected.begin(), expected.end(), waiting_periods.begin(), [](const auto &a, const auto &b) {
+                           return a.first == b.first && a.second == b.second;
+                       });
+        if (!same) {
+            remove(path.c_str());
+            throw runtime_error("the edge file disagrees with the graph from " + to_string(start) + " to " + to_string(end));
+        }
+    });
+
+    report.edge_file_bytes = filesystem::file_size(path);
+    remove(path.c_str());
+
+    report.series.insert(report.series.end(), { write, stream });
+}
+
+/**
+ * @brief Benchmarks every algorithm on a dataset
+ *
+ * @param path The dataset file
+ * @param options The command line options
+ * @return The measurements
+ */
+static DatasetReport bench_dataset(const string &path, const Options &options) {
+    DatasetReport report;
+    report.path = path;
+
+    Series parse{ "parse" }, build{ "build" }, compress{ "compress" };
+    AnyGraph any;
+
+    for (unsigned i = 0; i < options.loads; i++) {
+        File *file = nullptr;
+        measure(parse, [&]() { file = new File(path); });
+        measure(build, [&]() { any = load_graph(*file, options.order); });
+        delete file;
+
+        if (options.compress) {
+            measure(compress, [&]() { visit([](auto &graph) { graph.compress_adjacency(); }, any); });
+        }
+    }
+
+    report.series.push_back(parse);
+    report.series.push_back(build);
+    if (options.compress) {
+        report.series.push_back(compress);
+    }
+
+    visit([&](auto &graph) {
+        report.nodes = graph.size();
+        report.edges = graph.edge_count();
+        report.memory = graph.memory_usage();
+
+        // The dataset's own source and sink first, then random pairs
+        mt19937_64 rng(options.seed);
+        uniform_int_distribution<unsigned long> node(1, graph.size());
+
+        vector<pair<unsigned long, unsigned long>> pairs{ { 1, graph.size() } };
+        while (pairs.size() < options.queries) {
+            pairs.push_back({ node(rng), node(rng) });
+        }
+
+        using Index = decltype(graph.size());
+        using Weight = decltype(graph.get_flow(0));
+
+        Series capacity{ "get_max_capacity_path" }, pareto{ "get_pareto_optimal_path" };
+        Series max_size{ "get_path_for_group_of_max_size" }, meetup{ "get_earliest_meetup" }, waiting{ "get_waiting_periods" };
+
+        // Results go to buffers that are reused across queries, so that, once they and the graph's search state
+        // have grown, queries shouldn't allocate at all
+        vector<Index> path;
+        vector<tuple<Index, Index, Weight>> flow_path;
+        vector<pair<Index, Weight>> waiting_periods;
+
+        for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+            measure(capacity, [&]() { graph.get_max_capacity_path(start, end, path); });
+        });
+
+        for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+            measure(pareto, [&]() { graph.get_pareto_optimal_path(start, end, PathOrder::CAPACITY_FIRST, path); });
+        });
+
+        report.series.insert(report.series.end(), { capacity, pareto });
+        if (options.workers > 0) {
+            bench_workers(graph, pairs, capacity.mean(), options, report);
+        }
+
+        if (options.hot_swaps > 0) {
+            bench_hot_swap<decay_t<decltype(graph)>>(report.path, pairs, options, report);
+        }
+
+        if (options.edge_file) {
+            bench_edge_file(graph, pairs, options, report);
+        }
+
+        if (options.engines) {
+            bench_engines(graph, pairs, options, report);
+        }
+
+        if (options.skip_flows) {
+            return;
+        }
+
+        // The meetup and the waiting periods are computed over the flow of the maximum group
+        for_each_pair(pairs, options, [&](unsigned long start, unsigned long end) {
+            measure(max_size, [&]() { graph.get_path_for_group_of_max_size(start, end, flow_path); });
+            measure(meetup, [&]() { graph.get_earliest_meetup(start, end); });
+            measure(waiting, [&]() { graph.get_waiting_periods(start, end, waiting_periods); });
+        });
+
+        report.series.insert(report.series.end(), { max_size, meetup, waiting });
+    }, any);
+
+    report.huge_pages = huge_page_report();
+    return report;
+}
+
+/**
+ * @brief Escapes a string for JSON
+ *
+ * @param text The string
+ * @return The quoted and escaped string
+ */
+static string json_string(const string &text) {
+    string escaped = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+/**
+ * @brief Writes the measurements as JSON
+ *
+ * @param out The stream to write to
+ * @param reports The measurements of each dataset
+ * @param options The command line options
+ */
+static void write_json(ostream &out, const vector<DatasetReport> &reports, const Options &options) {
+    const char *modes[] = { "off", "transparent", "explicit" };
+
+    out << fixed << setprecision(3);
+    out << "{\n  \"seed\": " << options.seed << ",\n  \"queries\": " << options.queries << ",\n  \"huge_pages\": \""
+        << modes[(int) options.huge_pages] << "\",\n  \"compressed_adjacency\": " << (options.compress ? "true" : "false")
+        << ",\n  \"widest_engine\": \"" << engine_name(options.widest_engine) << "\",\n  \"flow_engine\": \""
+        << engine_name(options.flow_engine) << "\",\n  \"datasets\": [\n";
+
+    for (size_t d = 0; d < reports.size(); d++) {
+        const DatasetReport &report = reports[d];
+        out << "    {\n      \"file\": " << json_string(report.path) << ",\n      \"nodes\": " << report.nodes
+            << ",\n      \"edges\": " << report.edges << ",\n      \"memory_bytes\": " << report.memory
+            << ",\n      \"huge_pages\": { \"regions\": " << report.huge_pages.regions
+            << ", \"bytes\": " << report.huge_pages.bytes << ", \"explicit_bytes\": " << report.huge_pages.explicit_bytes
+            << ", \"advised_bytes\": " << report.huge_pages.advised_bytes
+            << ", \"transparent_bytes\": " << report.huge_pages.transparent_bytes << " },\n      \"edge_file\": { \"bytes\": "
+            << report.edge_file_bytes << ", \"peak_frontier\": " << report.peak_frontier << " },\n      \"operations\": [\n";
+
+        for (size_t s = 0; s < report.series.size(); s++) {
+            const Series &series = report.series[s];
+            size_t runs = max<size_t>(series.micros.size(), 1);
+
+            out << "        { \"name\": " << json_string(series.name) << ", \"runs\": " << series.micros.size()
+                << ", \"mean_us\": " << series.mean() << ", \"p50_us\": " << series.percentile(50)
+                << ", \"p99_us\": " << series.percentile(99)
+                << ", \"allocations_per_run\": " << (double) series.allocations / runs
+                << ", \"bytes_per_run\": " << (double) series.bytes / runs << " }"
+                << (s + 1 < report.series.size() ? ",\n" : "\n");
+        }
+
+        out << "      ],\n      \"worker_pools\": [\n";
+
+        for (size_t p = 0; p < report.pools.size(); p++) {
+            const PoolReport &pool = report.pools[p];
+
+            out << "        { \"workers\": " << pool.workers << ", \"queries\": " << pool.queries
+                << ", \"queries_per_second\": " << pool.queries / pool.seconds
+                << ", \"worker_private_kib\": " << pool.worker_private_kib << ", \"total_pss_kib\": " << pool.total_pss_kib
+                << ", \"parent_rss_kib\": " << pool.parent_rss_kib << " }" << (p + 1 < report.pools.size() ? ",\n" : "\n");
+        }
+
+        out << "      ]\n    }" << (d + 1 < reports.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n}\n";
+}
+
+/**
+ * @brief Writes the measurements as a table
+ *
+ * @param out The stream to write to
+ * @param report The measurements of a dataset
+ */
+static void write_table(ostream &out, const DatasetReport &report) {
+    out << report.path << " (" << report.nodes << " nodes, " << report.edges << " edges, " << fixed << setprecision(1)
+        << report.memory / 1048576.0 << " MiB)\n";
+    out << left << setw(34) << "operation" << right << setw(6) << "runs" << setw(14) << "mean us" << setw(14) << "p50 us"
+        << setw(14) << "p99 us" << setw(14) << "allocs/run" << setw(16) << "bytes/run" << "\n";
+
+    out << fixed << setprecision(1);
+    for (const Series &series : report.series) {
+        size_t runs = max<size_t>(series.micros.size(), 1);
+
+        out << left << setw(34) << series.name << right << setw(6) << series.micros.size() << setw(14) << series.mean()
+            << setw(14) << series.percentile(50) << setw(14) << series.percentile(99)
+            << setw(14) << (double) series.allocations / runs << setw(16) << (double) series.bytes / runs << "\n";
+    }
+
+    if (!report.pools.empty()) {
+        out << "\n" << left << setw(34) << "worker processes" << right << setw(6) << "" << setw(14) << "queries/s"
+            << setw(14) << "private KiB" << setw(14) << "total PSS KiB" << setw(14) << "parent RSS" << "\n";
+    }
+
+    for (const PoolReport &pool : report.pools) {
+        out << left << setw(34) << pool.workers << right << setw(6) << "" << setw(14) << pool.queries / pool.seconds
+            << setw(14) << pool.worker_private_kib << setw(14) << pool.total_pss_kib << setw(14) << pool.parent_rss_kib << "\n";
+    }
+
+    const HugePageReport &huge = report.huge_pages;
+    if (huge.regions > 0) {
+        out << "\nhuge pages: " << huge.regions << " arrays of " << (huge.bytes >> 20) << " MiB, "
+            << (huge.explicit_bytes >> 20) << " MiB from the reserved pool, " << (huge.advised_bytes >> 20) << " MiB advised, "
+            << (huge.transparent_bytes >> 20) << " MiB backed by transparent huge pages\n";
+    }
+
+    if (report.edge_file_bytes > 0) {
+        out << "\nedge file: " << report.edge_file_bytes / 1048576.0 << " MiB, at most " << report.peak_frontier
+            << " nodes held at once\n";
+    }
+
+    out << defaultfloat << endl;
+}
+
+/**
+ * @brief Parses the command line
+ *
+ * @return false if the options are invalid
+ */
+static bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--input-dir") == 0 && has_value) {
+            options.input_dir = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && has_value) {
+            options.json = argv[++i];
+        } else if (strcmp(argv[i], "--queries") == 0 && has_value) {
+            options.queries = max(stoul(argv[++i]), 1ul);
+        } else if (strcmp(argv[i], "--loads") == 0 && has_value) {
+            options.loads = max(stoul(argv[++i]), 1ul);
+        } else if (strcmp(argv[i], "--budget") == 0 && has_value) {
+            options.budget = stod(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.seed = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--order") == 0 && has_value) {
+            options.order = parse_node_order(argv[++i]);
+        } else if (strcmp(argv[i], "--skip-flows") == 0) {
+            options.skip_flows = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && has_value) {
+            options.workers = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--hot-swap") == 0 && has_value) {
+            options.hot_swaps = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--huge-pages") == 0 && has_value) {
+            options.huge_pages = parse_huge_pages(argv[++i]);
+        } else if (strcmp(argv[i], "--compress-adjacency") == 0) {
+            options.compress = true;
+        } else if (strcmp(argv[i], "--edge-file") == 0) {
+            options.edge_file = true;
+        } else if (strcmp(argv[i], "--engines") == 0) {
+            options.engines = true;
+        } else if (strcmp(argv[i], "--widest-engine") == 0 && has_value) {
+            options.widest_engine = parse_widest_path_engine(argv[++i]);
+        } else if (strcmp(argv[i], "--flow-engine") == 0 && has_value) {
+            options.flow_engine = parse_flow_engine(argv[++i]);
+        } else if (strcmp(argv[i], "--check-allocations") == 0) {
+            options.check_allocations = true;
+        } else if (argv[i][0] != '-') {
+            options.files.push_back(argv[i]);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    try {
+        if (!parse_options(argc, argv, options)) {
+            throw invalid_argument("Invalid option");
+        }
+    } catch (exception &e) {
+        cerr << "usage: travel_bench [--input-dir dir] [--queries n] [--loads n] [--budget seconds] [--seed n] [--json file]\n"
+             << "                    [--order file|bfs|topological|rcm] [--skip-flows] [--check-allocations] [--hot-swap n]\n"
+             << "                    [--workers n] [--huge-pages off|transparent|explicit] [--compress-adjacency]\n"
+             << "                    [--edge-file] [--engines] [--widest-engine auto|heap|buckets|dag]\n"
+             << "                    [--flow-engine auto|edmonds-karp|blocking|scaling] [dataset...]\n";
+        return 1;
+    }
+
+    set_huge_pages(options.huge_pages);
+    set_widest_path_engine(options.widest_engine);
+    set_flow_engine(options.flow_engine);
+
+    // Without explicit datasets, every bundled one is benchmarked
+    if (options.files.empty()) {
+        for (int i = 1; i <= 99; i++) {
+            ostringstream path;
+            path << options.input_dir << "/in" << setw(2) << setfill('0') << i << "_b.txt";
+
+            if (ifstream(path.str()).good()) {
+                options.files.push_back(path.str());
+            }
+        }
+    }
+
+    if (options.files.empty()) {
+        cerr << "No datasets found in " << options.input_dir << "\n";
+        return 1;
+    }
+
+    vector<DatasetReport> reports;
+    for (const string &path : options.files) {
+        try {
+            reports.push_back(bench_dataset(path, options));
+            write_table(cout, reports.back());
+        } catch (exception &e) {
+            cerr << path << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (!options.json.empty()) {
+        ofstream out(options.json);
+        write_json(out, reports, options);
+    }
+
+    // Warm queries must not allocate, while loading obviously does. Allocations are counted over every thread,
+    // so the hot swap series also count those of the loads running beside them. A pass over an edge file sets up
+    // its buffers and frontier each time, as it's meant for files too big to keep anything around
+    bool allocated = false;
+    for (const DatasetReport &report : reports) {
+        for (const Series &series : report.series) {
+            bool loading = series.name == "parse" || series.name == "build" || series.name == "compress" || series.name == "swap"
+                           || series.name == "write edge file" || series.name == "stream_earliest_meetup"
+                           || series.name.find("(hot swap)") != string::npos;
+
+            if (options.check_allocations && !loading && series.allocations > 0) {
+                cerr << report.path << ": " << series.name << " allocated " << series.allocations << " times ("
+                     << series.bytes << " bytes) over " << series.micros.size() << " warm queries\n";
+                allocated = true;
+            }
+        }
+    }
+
+    return allocated ? 1 : 0;
+}
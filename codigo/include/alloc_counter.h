@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+/** @brief The number of heap allocations and the bytes they requested */
+struct AllocationStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+/**
+ * @brief Gets the allocations made so far by every thread
+ *
+ * Counting is done by replacing the global operator new in src/alloc_counter.cpp, so only targets that link
+ * that file can call this.
+ *
+ * @return The allocations made since the program started
+ */
+AllocationStats allocation_stats();
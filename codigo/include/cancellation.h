@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+/**
+ * @brief Tells a query to stop early, because it was cancelled or because its timeout ran out
+ *
+ * Copies share their state, so a token can be handed to a query and cancelled from another thread or a signal
+ * handler. The timeout runs from the first time the token is polled, which the searches do as they start, so
+ * that the time spent before the query, such as reading its input, doesn't count.
+ */
+class CancellationToken {
+    struct State {
+        std::atomic<bool> cancelled{ false };
+
+        /** @brief Whether the token was polled, and the deadline that set in steady clock ticks, 0 until then */
+        std::atomic<bool> started{ false };
+        std::atomic<std::chrono::steady_clock::rep> deadline{ 0 };
+    };
+
+    std::shared_ptr<State> state;
+    std::chrono::steady_clock::duration timeout;
+
+    friend class CancelOnInterrupt;
+
+    public:
+        /**
+         * @brief Creates a token
+         *
+         * @param timeout How long a query may run once it starts polling the token, 0 for no limit
+         */
+        explicit CancellationToken(std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero());
+
+        /** @brief Makes every query polling this token, or a copy of it, stop */
+        void cancel() const;
+
+        /** @brief Tells whether the token was cancelled, by cancel or by a poll finding the timeout ran out */
+        bool is_cancelled() const;
+
+        /**
+         * @brief Tells whether the query should stop, starting the timeout the first time
+         *
+         * The clock is only read when there is a timeout, so callers should still poll every so many steps
+         * rather than on each one.
+         *
+         * @return true if the token was cancelled or the timeout ran out
+         */
+        bool poll() const;
+};
+
+/**
+ * @brief While alive, makes Ctrl-C cancel a token instead of ending the program
+ *
+ * Only once a query started polling the token: before that, as while its input is read, Ctrl-C still ends the
+ * program. The previous handler is restored on destruction. Only one may be alive at a time.
+ */
+class CancelOnInterrupt {
+    /** @brief Cancels the token once its query started, and otherwise ends the program as Ctrl-C would */
+    static void on_interrupt(int signal);
+
+    public:
+        /**
+         * @brief Routes Ctrl-C to a token
+         *
+         * @param token The token, which must outlive this
+         */
+        explicit CancelOnInterrupt(const CancellationToken &token);
+        ~CancelOnInterrupt();
+
+        CancelOnInterrupt(const CancelOnInterrupt &) = delete;
+        CancelOnInterrupt &operator=(const CancelOnInterrupt &) = delete;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "entities/graph.h"
+
+/** @brief What the registry knows about a dataset */
+struct DatasetInfo {
+    std::string name;
+    std::string path;
+    bool resident;
+
+    /** @brief The bytes it holds, while resident */
+    size_t bytes;
+
+    /** @brief How many times it was loaded */
+    uint64_t loads;
+};
+
+/**
+ * @brief Keeps several named datasets in memory, loading each on first use and evicting the least recently used
+ * ones once together they exceed a memory budget
+ *
+ * A dataset is either a text file or a snapshot, told apart by their first bytes. With a snapshot directory, each
+ * text dataset is saved there as a snapshot after it's parsed, and later loads read that snapshot instead, as long
+ * as it's newer than the text and its nodes were renumbered in the same order. Graphs can have their adjacency lists
+ * compressed as they're loaded, and are then counted against the budget at their compressed size.
+ *
+ * Graphs are handed out as copies, which share the topology. Evicting a dataset a query still uses only drops the
+ * registry's share: its memory is freed when the query lets go of it, and no longer counts against the budget.
+ * The dataset just asked for is never evicted, even if on its own it exceeds the budget. Files are read without
+ * holding the registry's lock, so other datasets can be listed and handed out meanwhile, and callers asking for a
+ * dataset that is already being loaded wait for that load instead of starting another.
+ */
+class DatasetRegistry {
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const AnyGraph> graph;
+
+        /** @brief The graph being loaded, valid from when a load starts until it's published */
+        std::shared_future<std::shared_ptr<const AnyGraph>> loading;
+
+        size_t bytes = 0;
+        uint64_t loads = 0;
+
+        /** @brief Where the dataset is in the recency list, while resident */
+        std::list<std::string>::iterator position;
+    };
+
+    NodeOrder order;
+    size_t budget;
+    std::string snapshot_dir;
+    bool compress;
+
+    mutable std::mutex entries_mutex;
+    std::map<std::string, Entry> entries;
+
+    /** @brief The names of the resident datasets, the most recently used first */
+    std::list<std::string> recency;
+    size_t resident_bytes = 0;
+
+    /**
+     * @brief Reads a dataset, from a snapshot if there is an up to date one
+     *
+     * @param path The file of the dataset
+     * @return The graph
+     */
+    AnyGraph read(const std::string &path) const;
+
+    /**
+     * @brief Reads a dataset and compresses its adjacency lists if the registry was asked to
+     *
+     * @param path The file of the dataset
+     * @return The graph
+     */
+    AnyGraph load(const std::string &path) const;
+
+    /**
+     * @brief Gets the snapshot a text dataset is cached in
+     *
+     * The snapshot is named after the canonical path of the text file, so that the same file always finds it
+     * under whatever name it's registered, and no other file does.
+     *
+     * @param path The file of the dataset
+     * @return The path of the snapshot, empty without a snapshot directory
+     */
+    std::string snapshot_path(const std::string &path) const;
+
+    /**
+     * @brief Evicts the least recently used datasets until the others fit in the budget
+     *
+     * @param keep The dataset that must stay
+     */
+    void evict(const std::string &keep);
+
+    public:
+        /**
+         * @brief Creates an empty registry
+         *
+         * @param order The order to renumber the nodes of text datasets in
+         * @param budget The bytes resident datasets may hold, 0 for no limit
+         * @param snapshot_dir Where text datasets are cached as snapshots, empty for nowhere
+         * @param compress Whether the adjacency lists of each dataset are compressed once it's loaded
+         */
+        DatasetRegistry(NodeOrder order = NodeOrder::FILE, size_t budget = 0, const std::string &snapshot_dir = "", bool compress = false);
+
+        /**
+         * @brief Registers a dataset, without loading it
+         *
+         * @param name The name queries select it by
+         * @param path Its file, text or snapshot. Registering a name again with another file drops the old one
+         */
+        void add(const std::string &name, const std::string &path);
+
+        /**
+         * @brief Tells whether a name was registered
+         *
+         * @param name The name
+         * @return true if it was
+         */
+        bool contains(const std::string &name) const;
+
+        /**
+         * @brief Gets the graph of a dataset, loading it if it isn't resident
+         *
+         * @param name The name of the dataset
+         * @return A copy of the graph, sharing its topology with the registry
+         * @throws std::out_of_range if the name wasn't registered, or whatever loading the file throws
+         */
+        AnyGraph get(const std::string &name);
+
+        /**
+         * @brief Describes every registered dataset
+         *
+         * @return The datasets, ordered by name
+         */
+        std::vector<DatasetInfo> list() const;
+
+        /** @brief Gets the bytes held by the resident datasets */
+        size_t get_resident_bytes() const;
+
+        /** @brief Gets the budget, 0 for no limit */
+        size_t get_budget() const;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "entities/graph.h"
+
+/**
+ * @brief Writes an edge file: a graph laid out as one block per node, in topological order
+ *
+ * A block is a node followed by the edges leaving it, each with its duration and, if the file has flows, the
+ * flow over it. Every node has a block, even without edges, and comes after every node with an edge to it. A
+ * pass over the file then knows all about a node by the time it reads its block, so it only has to hold the
+ * nodes it reached but hasn't read yet, and never the graph.
+ *
+ * Nodes are added as they're produced, so a graph too big for memory can be written without ever being built.
+ * The writer can't check the order, which is up to whoever produces the nodes. Values are written in the byte
+ * order of the machine, like snapshots, and the file only replaces an older one once it's closed.
+ */
+class EdgeStreamWriter {
+    std::string path;
+    FILE *file;
+
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    bool wide;
+    bool flows;
+
+    uint64_t nodes = 0;
+    uint64_t edges = 0;
+
+    /** @brief Writes the header, with the counts so far, at the start of the file */
+    void write_header();
+
+    /** @brief Writes a record of three values */
+    void put(uint64_t a, uint64_t b, uint64_t c);
+
+    void flush();
+
+    public:
+        /**
+         * @brief Starts an edge file
+         *
+         * @param path The file
+         * @param wide Whether values take 64 bits instead of 32
+         * @param flows Whether edges carry a flow, the passes only following edges with flow if so
+         * @throws std::runtime_error if the file can't be created
+         */
+        EdgeStreamWriter(const std::string &path, bool wide, bool flows);
+
+        /** @brief Discards the file, unless it was closed */
+        ~EdgeStreamWriter();
+
+        EdgeStreamWriter(const EdgeStreamWriter &) = delete;
+        EdgeStreamWriter &operator=(const EdgeStreamWriter &) = delete;
+
+        /**
+         * @brief Starts the block of a node, to which the following edges belong
+         *
+         * @param node The node, which can't be 0
+         * @throws std::out_of_range if the node doesn't fit in the file's values
+         */
+        void add_node(uint64_t node);
+
+        /**
+         * @brief Adds an edge leaving the last node added
+         *
+         * @param destination The node it goes to, which can't be 0
+         * @param duration Its duration
+         * @param flow The flow over it, ignored if the file has no flows
+         * @throws std::out_of_range if a value doesn't fit in the file's values
+         * @throws std::logic_error if no node was added yet
+         */
+        void add_edge(uint64_t destination, uint64_t duration, uint64_t flow = 0);
+
+        /**
+         * @brief Completes the file
+         *
+         * @throws std::runtime_error if it couldn't be written
+         */
+        void close();
+};
+
+/** @brief What an edge file holds, read from the start of it */
+struct EdgeStreamInfo {
+    /** @brief Whether values take 64 bits */
+    bool wide;
+
+    /** @brief Whether edges carry a flow */
+    bool flows;
+
+    uint64_t nodes;
+    uint64_t edges;
+};
+
+/** @brief What a streamed pass found, and what it took */
+struct StreamedMeetup {
+    /** @brief Whether the ending point was reached */
+    bool reached;
+
+    /** @brief The earliest time at which the group meets again at the ending point, 0 if it wasn't reached */
+    uint64_t earliest_meetup;
+
+    /** @brief The blocks and edges read */
+    uint64_t nodes;
+    uint64_t edges;
+
+    /** @brief The most nodes held at once, reached but whose block wasn't read yet */
+    uint64_t peak_frontier;
+};
+
+/** @brief The size of each buffer a pass reads the file through */
+constexpr size_t EDGE_STREAM_BUFFER = size_t(1) << 20;
+
+/**
+ * @brief Writes a graph as an edge file, in topological order
+ *
+ * @param graph The graph, with the ids of its dataset
+ * @param path The file
+ * @param flows Whether to write the current flows, so that passes only follow the edges with flow
+ * @throws std::invalid_argument if the graph has a cycle
+ */
+void write_edge_stream(const AnyGraph &graph, const std::string &path, bool flows);
+
+/**
+ * @brief Reads the header of an edge file
+ *
+ * @param path The file
+ * @param info Where the header is written
+ * @return false if the file can't be read or isn't an edge file written on this machine
+ */
+bool read_edge_stream_info(const std::string &path, EdgeStreamInfo &info);
+
+/**
+ * @brief Finds when a group meets again and where its elements wait, in one pass over an edge file
+ *
+ * This is get_earliest_meetup and get_waiting_periods without the graph: the group leaves the starting point at
+ * time 0 over the edges with flow (every edge, if the file has no flows), each node is left as soon as the
+ * last element arrives, and an element waits at a node for as long as it arrives before the last one.
+ *
+ * The file is read sequentially on another thread, a few buffers ahead of the pass, so memory is three buffers
+ * plus the nodes reached but not read yet.
+ *
+ * @param path The file
+ * @param start The starting point
+ * @param end The ending point
+ * @param on_wait Called with each node where elements wait and the longest wait there, in the order of the
+ * file; may be empty
+ * @param buffer_bytes The size of each buffer
+ * @return What the pass found
+ * @throws std::invalid_argument if the file can't be read or isn't an edge file
+ */
+StreamedMeetup stream_earliest_meetup(const std::string &path, uint64_t start, uint64_t end,
+                                      const std::function<void(uint64_t, uint64_t)> &on_wait = {},
+                                      size_t buffer_bytes = EDGE_STREAM_BUFFER);
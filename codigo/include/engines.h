@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+/**
+ * @brief The searches a widest path query can run on
+ *
+ * HEAP is Dijkstra's algorithm over a binary max-heap. BUCKET_QUEUE replaces the heap with a bucket per capacity
+ * value, taken from the biggest down, which needs capacities to span few values. DAG_SWEEP relaxes the nodes once
+ * each in topological order, with no queue at all, which needs the graph to be acyclic. AUTO picks one from the
+ * profile of the graph.
+ */
+enum class WidestPathEngine {
+    AUTO,
+    HEAP,
+    BUCKET_QUEUE,
+    DAG_SWEEP
+};
+
+/**
+ * @brief The algorithms a maximum flow can be found with
+ *
+ * EDMONDS_KARP augments along one shortest path per BFS. BLOCKING_FLOW (Dinic's algorithm) builds the levels of
+ * the residual graph with one BFS and then saturates every shortest path at once. CAPACITY_SCALING runs blocking
+ * flow over the residual edges of at least a threshold, halved whenever no path is left, so the widest paths go
+ * first. AUTO picks one from the profile of the graph.
+ */
+enum class FlowEngine {
+    AUTO,
+    EDMONDS_KARP,
+    BLOCKING_FLOW,
+    CAPACITY_SCALING
+};
+
+/**
+ * @brief Cheap statistics of a graph, gathered in one pass when it's loaded, that the engines are picked from
+ */
+struct GraphProfile {
+    /** @brief Whether the profile was gathered, which adding an edge undoes */
+    bool valid = false;
+
+    uint64_t nodes = 0;
+    uint64_t edges = 0;
+
+    /** @brief Whether the graph has no cycle */
+    bool acyclic = false;
+
+    /** @brief The most edges on a path, 0 if the graph has a cycle */
+    uint64_t depth = 0;
+
+    /** @brief The smallest and biggest capacity of an edge, 0 if there are none */
+    uint64_t min_capacity = 0;
+    uint64_t max_capacity = 0;
+
+    /** @brief Gets the average number of edges leaving a node */
+    double density() const;
+
+    /**
+     * @brief Writes the statistics on a single line, without a line break
+     *
+     * @param out The stream to write to
+     */
+    void print(std::ostream &out) const;
+};
+
+/** @brief An engine picked for a query, and why */
+template <class Engine>
+struct EngineChoice {
+    Engine engine;
+
+    /** @brief A sentence saying why, which is a string literal so that picking an engine never allocates */
+    const char *reason;
+};
+
+using WidestPathChoice = EngineChoice<WidestPathEngine>;
+using FlowChoice = EngineChoice<FlowEngine>;
+
+/** @brief Capacities spanning more values than this get a heap rather than a bucket per value */
+constexpr uint64_t BUCKET_QUEUE_LIMIT = uint64_t(1) << 16;
+
+/**
+ * @brief Picks the widest path engine for a graph
+ *
+ * The engine forced with set_widest_path_engine wins, unless the graph can't run it.
+ *
+ * @param profile The profile of the graph
+ * @return The engine and why
+ */
+WidestPathChoice choose_widest_path_engine(const GraphProfile &profile);
+
+/**
+ * @brief Picks the maximum flow engine for a graph
+ *
+ * The engine forced with set_flow_engine wins, unless the graph can't run it. Otherwise, a flow handed out as the
+ * route of a group stays on Edmonds-Karp, since the engines split an equal flow over different buses and the
+ * meetup and waiting periods follow that route, and only the flows that are never shown get blocking flow.
+ *
+ * @param profile The profile of the graph
+ * @param bounded Whether the flow is capped at a group size, which only Edmonds-Karp can stop at
+ * @param routed Whether the flow is handed out as the route of a group
+ * @return The engine and why
+ */
+FlowChoice choose_flow_engine(const GraphProfile &profile, bool bounded, bool routed);
+
+/**
+ * @brief Forces the engine of every widest path query from now on, AUTO to pick it again
+ *
+ * @param engine The engine
+ */
+void set_widest_path_engine(WidestPathEngine engine);
+
+/** @brief Gets the widest path engine forced, AUTO if none */
+WidestPathEngine get_widest_path_engine();
+
+/**
+ * @brief Forces the engine of every maximum flow from now on, AUTO to pick it again
+ *
+ * @param engine The engine
+ */
+void set_flow_engine(FlowEngine engine);
+
+/** @brief Gets the maximum flow engine forced, AUTO if none */
+FlowEngine get_flow_engine();
+
+/**
+ * @brief Reads the name of a widest path engine, as given on the command line
+ *
+ * @param name auto, heap, buckets or dag
+ * @return The engine
+ * @throws std::invalid_argument if the name is unknown
+ */
+WidestPathEngine parse_widest_path_engine(const std::string &name);
+
+/**
+ * @brief Reads the name of a maximum flow engine, as given on the command line
+ *
+ * @param name auto, edmonds-karp, blocking or scaling
+ * @return The engine
+ * @throws std::invalid_argument if the name is unknown
+ */
+FlowEngine parse_flow_engine(const std::string &name);
+
+/** @brief Gets the name of an engine, as given on the command line */
+const char *engine_name(WidestPathEngine engine);
+const char *engine_name(FlowEngine engine);
+
+/**
+ * @brief The engines a query ran on, kept per thread like the statistics
+ *
+ * A query may run both kinds, or neither, in which case the choice is left empty.
+ */
+struct EngineReport {
+    bool widest_path_used = false;
+    WidestPathChoice widest_path{ WidestPathEngine::AUTO, "" };
+
+    bool flow_used = false;
+    FlowChoice flow{ FlowEngine::AUTO, "" };
+
+    /** @brief The time spent in each kind of engine, timed around the engine alone */
+    double widest_path_milliseconds = 0;
+    double flow_milliseconds = 0;
+
+    /** @brief The profile of the graph the last engine was picked for */
+    GraphProfile profile;
+
+    /**
+     * @brief Writes the engines, why they were picked, how long they took and the profile they were picked from,
+     * a line each
+     *
+     * @param out The stream to write to
+     */
+    void print(std::ostream &out) const;
+};
+
+/**
+ * @brief Gets the engines picked on the calling thread since start_engine_report
+ *
+ * @return The report
+ */
+inline EngineReport &engine_report() {
+    thread_local EngineReport report;
+    return report;
+}
+
+/** @brief Empties the calling thread's report before a new query */
+void start_engine_report();
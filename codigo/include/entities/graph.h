@@ -2,45 +2,193 @@
 
 #include <vector>
 #include <list>
+#include <iosfwd>
 #include <set>
 #include <tuple>
+#include <cstdint>
+#include <variant>
+#include <limits>
+#include <type_traits>
+#include <memory>
 
-class Graph;
+#include "cancellation.h"
+#include "engines.h"
+#include "flow_overlay.h"
+#include "huge_pages.h"
+#include "max_heap.h"
 
-#include "dataset.h"
+template <class Index, class Weight> class BasicGraph;
 
-struct Node {
-    std::vector<unsigned long> outgoing;
-    std::vector<unsigned long> incoming;
+#include "dataset.h"
 
+/**
+ * @brief Holds the state of the last search through a node
+ *
+ * @tparam Index The type used for node and edge ids
+ * @tparam Weight The type used for capacities, durations and flows
+ */
+template <class Index, class Weight>
+struct BasicNode {
     bool visited;
-    unsigned int parent;
+    Index parent;
 
     /** @brief Search parameters */
-    unsigned long distance;
-    unsigned long capacity;
-    unsigned long flow_increase;
-    unsigned long earliest_start;
-    unsigned long in_degree;
+    Weight distance;
+    Weight capacity;
+    Weight flow_increase;
+    Weight earliest_start;
+    Index in_degree;
+};
+
+/**
+ * @brief Holds the edges leaving and entering a node
+ *
+ * @tparam Index The type used for edge ids
+ */
+template <class Index>
+struct BasicAdjacency {
+    std::vector<Index> outgoing;
+    std::vector<Index> incoming;
 };
 
-/** @brief Manages a Edge */
-class Edge {
+/**
+ * @brief The adjacency lists of every node packed into a single byte array
+ *
+ * Each list is stored as the differences between consecutive edge ids, zigzag-encoded so that lists in any order
+ * come back the same, as varints of 7 bits per byte. Edge ids within a list are mostly increasing and close
+ * together, so most of them take a byte or two instead of sizeof(Index), and a node costs one offset instead of
+ * two vectors. Lists are decoded as they are walked, so searches run on them directly.
+ *
+ * @tparam Index The type used for edge ids
+ */
+template <class Index>
+class BasicCompressedAdjacency {
+    /** @brief For each node, the length of its outgoing list in bytes, then its outgoing and incoming lists */
+    HugeVector<uint8_t> bytes;
+
+    /** @brief Where each node starts in bytes, and where the last one ends */
+    HugeVector<uint64_t> offsets;
+
+    /** @brief Reads a varint, moving past it */
+    static uint64_t read_varint(const uint8_t *&at) {
+        uint64_t value = *at++;
+        if (value < 0x80) {
+            return value;
+        }
+
+        value &= 0x7f;
+        for (unsigned shift = 7;; shift += 7) {
+            uint64_t byte = *at++;
+            value |= (byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+    }
+
+    public:
+        /** @brief A list of edge ids, decoded while it's walked */
+        class List {
+            const uint8_t *first, *last;
+
+            public:
+                class iterator {
+                    const uint8_t *at, *next;
+                    Index value;
+
+                    /** @brief Decodes the id after the current one, into value */
+                    void decode() {
+                        uint64_t zigzag = read_varint(next);
+                        value += (Index) ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                    }
+
+                    public:
+                        /**
+                         * @brief Starts at the given byte
+                         *
+                         * @param at The byte
+                         * @param first Whether it's the start of the list, whose first id is then decoded
+                         */
+                        iterator(const uint8_t *at, bool first) : at(at), next(at), value(0) { if (first) decode(); }
+
+                        Index operator*() const { return value; }
+                        iterator &operator++() { at = next; decode(); return *this; }
+                        bool operator!=(const iterator &other) const { return at != other.at; }
+                };
+
+                List(const uint8_t *first, const uint8_t *last) : first(first), last(last) {}
+
+                iterator begin() const { return iterator(first, true); }
+                iterator end() const { return iterator(last, false); }
+                bool empty() const { return first == last; }
+        };
+
+        /** @brief The lists of a node */
+        struct Lists {
+            List outgoing;
+            List incoming;
+        };
+
+        /**
+         * @brief Packs adjacency lists
+         *
+         * @param adjacency The lists of each node
+         */
+        void build(const HugeVector<BasicAdjacency<Index>> &adjacency);
+
+        /**
+         * @brief Gets the lists of a node
+         *
+         * @param node The node
+         * @return Its outgoing and incoming edge ids
+         */
+        Lists operator[](size_t node) const {
+            const uint8_t *at = bytes.data() + offsets[node];
+            uint64_t outgoing = read_varint(at);
+
+            return { List(at, at + outgoing), List(at + outgoing, bytes.data() + offsets[node + 1]) };
+        }
+
+        /**
+         * @brief Decodes the lists of a node
+         *
+         * @param node The node
+         * @return A copy of its lists
+         */
+        BasicAdjacency<Index> decode(size_t node) const;
+
+        /** @brief Tells whether there are no lists, as before build() */
+        bool empty() const;
+
+        /** @brief Gets the bytes held */
+        size_t memory_usage() const;
+};
+
+/**
+ * @brief Manages a Edge
+ *
+ * Edges only hold the static description of a trip, their flows are kept by the graph.
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for capacities, durations and flows
+ */
+template <class Index, class Weight>
+class BasicEdge {
 
     /** @brief The edge's origin */
-    unsigned long origin;
+    Index origin;
 
     /** @brief The Edge' destination */
-    unsigned long destination;
+    Index destination;
 
     /** @brief The Edge' capacity */
-    unsigned long capacity;
-
-    /** @brief The Edge's flow */
-    unsigned long flow;
+    Weight capacity;
 
     /** @brief The trip's duration */
-    unsigned long duration;
+    Weight duration;
+
+    /** @brief The trip's scheduled departure, 0 if it has no timetable */
+    Weight departure;
 
     /** @brief Whether this edge is active or not */
     bool active = true;
@@ -49,198 +197,924 @@ class Edge {
 
         /**
          * @brief Construct a new Edge object
-         * 
+         *
          * @param origin The edge's origin
          * @param destination The Edge' destination
          * @param capacity The Edge' capacity
          * @param duration The trip's duration
+         * @param departure The trip's scheduled departure
          */
-        Edge(unsigned long origin, unsigned long destination, unsigned long capacity, unsigned long duration);
+        BasicEdge(Index origin, Index destination, Weight capacity, Weight duration, Weight departure = 0);
 
         /**
          * @brief Edge copy constructor
          */
-        Edge(const Edge &edge);
+        BasicEdge(const BasicEdge &edge);
+
+        BasicEdge &operator=(const BasicEdge &edge) = default;
 
         /**
          * @brief Creates a Edge object from a vector of entries
-         * 
-         * @param entry 
+         *
+         * @param entry
          * @return Edge object
          */
-        static Edge from_entry(const FileEntry &entry);
+        static BasicEdge from_entry(const FileEntry &entry);
 
         /**
          * @brief Creates all Edge from a file
-         * 
-         * @param file 
-         * @return vector<Edge> 
+         *
+         * @param file
+         * @return vector<Edge>
          */
-        static std::vector<Edge> from_file(const File &file);
+        static std::vector<BasicEdge> from_file(const File &file);
 
         /** Getters */
-        unsigned long get_origin() const;
-        unsigned long get_destination() const;
-        unsigned long get_capacity() const;
-        unsigned long get_flow() const;
-        unsigned long get_duration() const;
+        Index get_origin() const;
+        Index get_destination() const;
+        Weight get_capacity() const;
+        Weight get_duration() const;
+        Weight get_departure() const;
+        bool is_active() const;
 
         /** Setters */
-        void set_flow(unsigned long flow);
+        void set_active(bool active);
+
+};
+
+/**
+ * @brief The edges of a graph, with each attribute stored in its own array
+ *
+ * Whole-graph passes that need a single attribute stream through that array alone, instead of loading every
+ * field of every edge. Indexing returns a BasicEdge copy built from the arrays, so code written against the Edge
+ * getters keeps working.
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for capacities and durations
+ */
+template <class Index, class Weight>
+class BasicEdgeTable {
+    HugeVector<Index> origins;
+    HugeVector<Index> destinations;
+    HugeVector<Weight> capacities;
+    HugeVector<Weight> durations;
+    HugeVector<Weight> departures;
+
+    /** @brief Bytes rather than a bit-packed std::vector<bool>, so that scans over it can be vectorized */
+    HugeVector<uint8_t> active;
+
+    public:
+        using Edge = BasicEdge<Index, Weight>;
+
+        /** @brief Walks the edges in id order, giving a copy of each */
+        class const_iterator {
+            const BasicEdgeTable *table;
+            size_t e;
+
+            public:
+                const_iterator(const BasicEdgeTable *table, size_t e) : table(table), e(e) {}
+
+                Edge operator*() const { return (*table)[e]; }
+                const_iterator &operator++() { e++; return *this; }
+                bool operator!=(const const_iterator &other) const { return e != other.e; }
+        };
+
+        /**
+         * @brief Adds an edge, which gets the next id
+         *
+         * @param edge The edge
+         */
+        void push_back(const Edge &edge);
+
+        /**
+         * @brief Gets a copy of an edge
+         *
+         * @param e The id of the edge
+         * @return The edge
+         */
+        Edge operator[](size_t e) const;
+
+        /**
+         * @brief Gets a copy of an edge, checking its id
+         *
+         * @param e The id of the edge
+         * @return The edge
+         */
+        Edge at(size_t e) const;
+
+        /**
+         * @brief Activates or deactivates an edge
+         *
+         * @param e The id of the edge
+         * @param active Whether the edge is active
+         */
+        void set_active(size_t e, bool active);
+
+        /**
+         * @brief Writes every column as raw native-endian arrays, one after the other
+         *
+         * @param out The stream to write to
+         */
+        void write(std::ostream &out) const;
+
+        /**
+         * @brief Replaces the edges with ones written by write()
+         *
+         * @param in The stream to read from
+         * @param count The number of edges written
+         * @return false if the stream ended early
+         */
+        bool read(std::istream &in, size_t count);
+
+        /** @brief Gets the bytes held by the columns */
+        size_t memory_usage() const;
+
+        size_t size() const;
+        const_iterator begin() const;
+        const_iterator end() const;
 
+        /** Columns, indexed by edge id */
+        const HugeVector<Index> &get_origins() const;
+        const HugeVector<Index> &get_destinations() const;
+        const HugeVector<Weight> &get_capacities() const;
+        const HugeVector<Weight> &get_durations() const;
+        const HugeVector<Weight> &get_departures() const;
+        const HugeVector<uint8_t> &get_active() const;
 };
 
-class Graph {
-    unsigned long n;
-    std::vector<Node> nodes;
-    std::vector<Edge> edges;
+/**
+ * @brief Heap key of a pareto search: a single 64-bit integer when both halves fit in 32 bits, a pair otherwise
+ */
+template <class Weight>
+using PackedKey = std::conditional_t<sizeof(Weight) <= sizeof(uint32_t), uint64_t, std::pair<Weight, Weight>>;
+
+/**
+ * @brief Builds a key that compares by high first and by low on ties
+ */
+template <class Weight>
+constexpr PackedKey<Weight> pack_key(Weight high, Weight low) {
+    if constexpr (sizeof(Weight) <= sizeof(uint32_t)) {
+        return (uint64_t(high) << 32) | low;
+    } else {
+        return { high, low };
+    }
+}
+
+/** @brief Prefers the biggest capacity, then the fewest bus transfers */
+struct CapacityFirst {
+    template <class Weight>
+    static constexpr Weight cost(Weight /*duration*/) { return 1; }
+
+    template <class Weight>
+    static constexpr PackedKey<Weight> key(Weight capacity, Weight distance) {
+        return pack_key<Weight>(capacity, std::numeric_limits<Weight>::max() - distance);
+    }
+};
+
+/** @brief Prefers the fewest bus transfers, then the biggest capacity */
+struct HopsFirst {
+    template <class Weight>
+    static constexpr Weight cost(Weight /*duration*/) { return 1; }
+
+    template <class Weight>
+    static constexpr PackedKey<Weight> key(Weight capacity, Weight distance) {
+        return pack_key<Weight>(std::numeric_limits<Weight>::max() - distance, capacity);
+    }
+};
+
+/** @brief Prefers the biggest capacity, then the shortest total duration */
+struct DurationAware {
+    template <class Weight>
+    static constexpr Weight cost(Weight duration) { return duration; }
+
+    template <class Weight>
+    static constexpr PackedKey<Weight> key(Weight capacity, Weight distance) {
+        return pack_key<Weight>(capacity, std::numeric_limits<Weight>::max() - distance);
+    }
+};
+
+/** @brief The orderings a pareto search can be run with */
+enum class PathOrder {
+    CAPACITY_FIRST,
+    HOPS_FIRST,
+    DURATION_AWARE
+};
+
+/**
+ * @brief The orders nodes can be renumbered in when a graph is loaded
+ *
+ * FILE keeps the ids of the dataset. BFS numbers nodes in breadth-first order from node 1, ignoring the direction
+ * of edges, TOPOLOGICAL in topological order, and RCM in reverse Cuthill-McKee order, which keeps the ids of
+ * neighbors close together. Users always see the ids of the dataset.
+ */
+enum class NodeOrder {
+    FILE,
+    BFS,
+    TOPOLOGICAL,
+    RCM
+};
+
+/**
+ * @brief The best path left when one edge of a route is cancelled
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for capacities
+ */
+template <class Index, class Weight>
+struct BasicReplacementPath {
+    /** @brief The origin of the cancelled edge */
+    Index origin;
+
+    /** @brief The destination of the cancelled edge */
+    Index destination;
+
+    /** @brief The nodes of the best path avoiding the cancelled edge, empty if there is none */
+    std::list<Index> path;
+
+    /** @brief The capacity of that path */
+    Weight capacity;
+};
+
+/**
+ * @brief Manages a graph
+ *
+ * @tparam Index The type used for node and edge ids
+ * @tparam Weight The type used for capacities, durations and flows
+ */
+template <class Index, class Weight>
+class BasicGraph {
+    public:
+        using Node = BasicNode<Index, Weight>;
+        using Edge = BasicEdge<Index, Weight>;
+        using Adjacency = BasicAdjacency<Index>;
+        using EdgeTable = BasicEdgeTable<Index, Weight>;
+        using CompressedAdjacency = BasicCompressedAdjacency<Index>;
+
+        /**
+         * @brief The immutable part of a graph, shared by every copy of it
+         *
+         * When nodes were renumbered, adjacency and edges use the internal ids, and the two maps translate them
+         * to and from the ids of the dataset. Otherwise the maps are empty.
+         *
+         * Once the adjacency lists are compressed, they are only held by compressed and adjacency is empty.
+         */
+        struct Topology {
+            Index n = 0;
+            HugeVector<Adjacency> adjacency;
+            CompressedAdjacency compressed;
+            EdgeTable edges;
+            std::vector<Index> to_internal;
+            std::vector<Index> to_external;
+            NodeOrder order = NodeOrder::FILE;
+
+            /**
+             * @brief The statistics the engines are picked from, and, when the graph is acyclic, a topological
+             * order of the nodes and the position of each node in it, for the DAG sweep
+             */
+            GraphProfile profile;
+            HugeVector<Index> topological_order;
+            HugeVector<Index> topological_position;
+
+            /**
+             * @brief Calls f with the adjacency lists, compressed or not, so that code walking them is compiled for both
+             *
+             * Both are indexed by node and give lists that can be walked with a range-for.
+             */
+            template <class F>
+            decltype(auto) visit_adjacency(F &&f) const {
+                if (!compressed.empty()) {
+                    return f(compressed);
+                }
+
+                return f(adjacency);
+            }
+        };
+
+    private:
+        /**
+         * @brief Search state, which is never shared: copies start with an empty one
+         *
+         * The heaps and queues keep their storage between searches, so that repeated queries don't allocate.
+         */
+        struct Workspace {
+            HugeVector<Node> nodes;
+            MaxHeap<Index, Weight> heap;
+            MaxHeap<Index, PackedKey<Weight>> packed_heap;
+            HugeVector<Index> queue;
+            HugeVector<Index> flowing;
+
+            /** @brief The buckets of the bucket queue, one per capacity */
+            std::vector<std::vector<Index>> buckets;
+
+            /** @brief The level of each node, its current arc and the path being extended by blocking flow */
+            HugeVector<Index> levels;
+            HugeVector<Index> arcs;
+            HugeVector<Index> path;
+
+            Workspace() = default;
+            Workspace(const Workspace &) {}
+            Workspace &operator=(const Workspace &) { nodes.clear(); return *this; }
+            Workspace(Workspace &&) = default;
+            Workspace &operator=(Workspace &&) = default;
+        };
+
+        Index n = 0;
+        std::shared_ptr<Topology> topology;
+        FlowOverlay<Weight> flows;
+        Workspace workspace;
+
+        /** @brief The capacities set for this graph only, or none to use the topology's */
+        HugeVector<Weight> capacities;
+
+        /** @brief The steps a search takes between polls of the cancellation token */
+        static constexpr unsigned POLL_INTERVAL = 1024;
+
+        /**
+         * @brief The token the searches stop at, and whether one stopped since it was set
+         *
+         * Mutable, as the const searches poll it too. Once a search stopped, the ones after it in the same query
+         * stop at once.
+         */
+        mutable CancellationToken cancellation;
+        mutable unsigned until_poll = 1;
+        mutable bool interrupted = false;
+
+        /**
+         * @brief Tells whether the running search should stop, polling the token every POLL_INTERVAL steps so
+         * that inner loops only pay for a counter
+         */
+        bool should_stop() const {
+            if (interrupted) {
+                return true;
+            }
+            if (--until_poll > 0) {
+                return false;
+            }
+
+            until_poll = POLL_INTERVAL;
+            return interrupted = cancellation.poll();
+        }
+
+        /** @brief Sizes the search state before a search */
+        HugeVector<Node> &prepare_nodes();
+
+        /** @brief Gets a topology this graph can modify, copying it if it is shared */
+        Topology &mutable_topology();
+
+        /** @brief Gathers the profile of the topology, which must not be shared yet */
+        void update_profile();
+
+        /**
+         * @brief Sends the flow increase the last search found to end along the parents it left
+         *
+         * @return The flow sent
+         */
+        Weight augment(Index start, Index end);
+
+        /*
+         * The searches over either kind of adjacency lists, plain or compressed, compiled for each. The public
+         * overloads run them on the kind the topology holds.
+         */
+        template <class Lists> void max_capacity_dijkstra(const Lists &adjacency, Index start);
+        template <class Order, class Lists> void pareto_optimal_dijkstra(const Lists &adjacency, Index start);
+        template <class Lists> void max_capacity_buckets(const Lists &adjacency, Index start);
+        template <class Lists> void max_capacity_dag_sweep(const Lists &adjacency, Index start);
+        template <class Lists> void max_flow_increase_bfs(const Lists &adjacency, Index start);
+        template <class Lists> void blocking_flow(const Lists &adjacency, Index start, Index end, Weight threshold);
+        template <class Lists> std::vector<Weight> remaining_duration_bounds(const Lists &adjacency, Index end) const;
+        template <class Lists>
+        std::tuple<std::list<Index>, Weight, Weight> get_budgeted_path(const Lists &adjacency, Index start, Index end, Weight budget);
+        template <class Lists> void biggest_duration(const Lists &adjacency, Index start);
+        template <class Lists>
+        void get_waiting_periods(const Lists &adjacency, Index start, Index end, std::vector<std::pair<Index, Weight>> &waiting_periods);
+        template <class Lists> void residual_widest_paths(const Lists &adjacency, Index start, Index end);
+        template <class Lists>
+        std::vector<BasicReplacementPath<Index, Weight>> get_replacement_paths(const Lists &adjacency, Index start, Index end);
 
     public:
 
-        Graph() {};
-  
+        BasicGraph();
+
         /**
          * @brief Construct a new Graph object
-         * 
+         *
          * @param n The number of nodes in this graph
          */
-        Graph(int n);
+        BasicGraph(Index n);
 
 
         /**
          * @brief Copy constructor for a graph
-         * 
-         * @param g 
+         *
+         * The copy shares the topology and the flows of g, which are only copied when written to.
+         * This makes copying a graph to try out another flow plan cost O(changed edges).
+         * The search state is not copied.
+         *
+         * @param g
+         */
+        BasicGraph(const BasicGraph &g);
+
+        /**
+         * @brief Creates a graph over a topology built elsewhere, such as read from a snapshot, with no flow
+         *
+         * @param topology The topology, whose adjacency must match its edges
+         */
+        explicit BasicGraph(std::shared_ptr<Topology> topology);
+
+        BasicGraph &operator=(const BasicGraph &g) = default;
+        BasicGraph(BasicGraph &&g) = default;
+        BasicGraph &operator=(BasicGraph &&g) = default;
+
+        /**
+         * @brief Creates a graph holding all the edges in a file
+         *
+         * Unless the order is NodeOrder::FILE, nodes are renumbered so that neighbors are close in memory, and
+         * edges are sorted by origin. Queries still take and return the ids of the dataset, but edge ids and the
+         * low-level searches use the internal ones.
+         *
+         * @param file The dataset file
+         * @param order The order to renumber the nodes in
+         * @return The graph described by the file
+         */
+        static BasicGraph from_file(const File &file, NodeOrder order = NodeOrder::FILE);
+
+        /**
+         * @brief Translates the id of a node in the dataset to the id it has in the graph
+         *
+         * @param node The id in the dataset
+         * @return The internal id, the same one unless nodes were renumbered
          */
-        Graph(const Graph &g);
+        Index to_internal_id(Index node) const;
+
+        /**
+         * @brief Translates the id of a node in the graph to the id it has in the dataset
+         *
+         * @param node The internal id
+         * @return The id in the dataset
+         */
+        Index to_external_id(Index node) const;
+
+        /**
+         * @brief Checks whether the values in a file can be represented by this graph's types
+         *
+         * @param file The dataset file
+         * @return true if every id, capacity, duration and resulting sum fits in Index and Weight
+         */
+        static bool fits(const File &file);
 
         /**
          * @brief Add a edge to this graph
-         * 
+         *
          * @param edge The edge to add to this graph
          */
         void add_edge(const Edge &edge);
 
         /**
          * @brief Alters the graph to contain information about the maximum capacity path
-         * 
-         * @param start The starting point
+         *
+         * @param start The starting point, as an internal id
+         */
+        void max_capacity_dijkstra(Index start);
+
+        /**
+         * @brief Like max_capacity_dijkstra, taking nodes from a bucket per capacity instead of a heap
+         *
+         * The buckets are scanned from the biggest capacity of the graph down, so this suits graphs whose
+         * capacities span few values. Needs the profile.
+         *
+         * @param start The starting point, as an internal id
+         */
+        void max_capacity_buckets(Index start);
+
+        /**
+         * @brief Like max_capacity_dijkstra, relaxing each node once in topological order, without any queue
+         *
+         * Needs the profile of an acyclic graph.
+         *
+         * @param start The starting point, as an internal id
+         */
+        void max_capacity_dag_sweep(Index start);
+
+        /**
+         * @brief Finds the widest paths from a node with the engine picked for this graph
+         *
+         * The engine and why it was picked are recorded in the calling thread's engine_report().
+         *
+         * @param start The starting point, as an internal id
+         */
+        void widest_paths(Index start);
+
+        /**
+         * @brief Gets the statistics gathered when the graph was loaded
+         *
+         * Adding an edge invalidates them, after which the engines fall back to a heap and Edmonds-Karp.
+         */
+        const GraphProfile &get_profile() const;
+
+        Index size() const;
+
+        /** @brief Number of edges in the graph */
+        Index edge_count() const;
+
+        /** @brief Gets a copy of the edge with the given id */
+        Edge get_edge(Index e) const;
+
+        /** @brief Gets a copy of the ids of the edges leaving and entering a node */
+        Adjacency get_adjacency(Index node) const;
+
+        /**
+         * @brief Packs the adjacency lists into delta-encoded varints, which every search then walks directly
+         *
+         * This takes a fraction of the memory of the lists, for somewhat slower searches. Adding an edge unpacks them.
+         */
+        void compress_adjacency();
+
+        /** @brief Tells whether the adjacency lists are compressed */
+        bool is_compressed() const;
+
+        /** @brief Gets the shared topology of this graph */
+        std::shared_ptr<const Topology> get_topology() const;
+
+        /**
+         * @brief Gets the bytes held by the topology, the flows and the capacities set for this graph, leaving out
+         * the search state
+         *
+         * Copies share the topology and the flows, so they report the same bytes for them.
          */
-        void max_capacity_dijkstra(unsigned long start);
+        size_t memory_usage() const;
 
-        unsigned long size();
+        /** @brief Gets the flow of the edge with the given id */
+        Weight get_flow(Index e) const;
+
+        /** @brief Sets the flow of the edge with the given id */
+        void set_flow(Index e, Weight flow);
+
+        /** @brief Removes the flow from every edge */
+        void clear_flows();
+
+        /**
+         * @brief Replaces the capacity of every edge for the searches of this graph only
+         *
+         * The topology, and the capacities it holds, stay shared with the copies of this graph, so that capacities
+         * can be sampled without copying the edges. They must not exceed the topology's, which the profile describes.
+         *
+         * @param capacities The capacity of each edge by id, or none to go back to the topology's
+         */
+        void set_capacities(const HugeVector<Weight> &capacities);
+
+        /** @brief Gets the capacity of each edge by id, as the searches of this graph use them */
+        const HugeVector<Weight> &get_capacities() const;
+
+        /**
+         * @brief Makes the searches stop early once a token is cancelled or its timeout runs out
+         *
+         * A query that stops returns the best it found so far: the flow routed until then, the widest path found
+         * to the ending point even if it wasn't settled, the waiting periods of the nodes whose start was settled.
+         * The minimum cut, the critical edges and the replacement paths come out empty, as they need every
+         * search they run to finish.
+         *
+         * @param token The token, replacing the previous one
+         */
+        void set_cancellation(const CancellationToken &token);
+
+        /** @brief Tells whether a search stopped early since the token was set, so that the result is partial */
+        bool was_interrupted() const;
+
+        /**
+         * @brief Activates or cancels an edge, inactive edges are ignored by every search
+         *
+         * @param e The id of the edge
+         * @param active Whether the edge is active
+         */
+        void set_active(Index e, bool active);
 
         /**
          * @brief Alters the graph to contain information about the pareto optimal paths
-         * 
-         * @param start The starting point
+         *
+         * @tparam Order The ordering policy (CapacityFirst, HopsFirst or DurationAware)
+         * @param start The starting point, as an internal id
          */
-        void pareto_optimal_dijkstra(unsigned long start, bool max_capacity);
+        template <class Order>
+        void pareto_optimal_dijkstra(Index start);
 
         /**
          * @brief Alters the graph to contain information about the shortest paths and their maximum flow increase
-         * 
-         * @param start The starting point
+         *
+         * @param start The starting point, as an internal id
          */
-        void max_flow_increase_bfs(unsigned long start);
+        void max_flow_increase_bfs(Index start);
 
         /**
          * @brief Alters the graph to contain information about the biggest duration path
-         * 
-         * @param start The starting point
+         *
+         * @param start The starting point, as an internal id
          */
-        void biggest_duration(unsigned long start);
+        void biggest_duration(Index start);
 
         /**
          * @brief Calculates the optimal path between two points
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @return A list containing all the nodes in the path
          */
-        std::tuple<std::list<unsigned long>, unsigned long, unsigned long> get_path(unsigned long start, unsigned long end);
+        std::tuple<std::list<Index>, Weight, Weight> get_path(Index start, Index end);
+
+        /**
+         * @brief Reads the optimal path between two points into a buffer, which is reused without allocating
+         * once it has grown to the length of the path
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param path Replaced by the nodes in the path, empty if end wasn't reached
+         * @return The capacity and the distance of the path
+         */
+        std::pair<Weight, Weight> get_path(Index start, Index end, std::vector<Index> &path);
+
+        /**
+         * @brief Calculates the shortest total duration from every node to a destination, sweeping incoming edges
+         *
+         * @param end The destination
+         * @return The shortest duration from each node, the maximum value if it can't reach the destination
+         */
+        std::vector<Weight> remaining_duration_bounds(Index end) const;
 
         /**
          * @brief Calculates the path that holds the most people in a group
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @return A list containing all the nodes in the optimal path
          */
-        std::tuple<std::list<unsigned long>, unsigned long, unsigned long> get_max_capacity_path(unsigned long start, unsigned long end);
+        std::tuple<std::list<Index>, Weight, Weight> get_max_capacity_path(Index start, Index end);
 
         /**
-         * @brief Calculates the path that requires least bus transfers
-         * 
+         * @brief Calculates the path that holds the most people in a group, without allocating once warmed up
+         *
          * @param start The starting point
          * @param end The ending point
-         * @return A list containing all the nodes in the optimal path
+         * @param path Replaced by the nodes in the optimal path
+         * @return The capacity and the distance of the path
          */
-        std::tuple<std::list<unsigned long>, unsigned long, unsigned long> get_pareto_optimal_path(unsigned long start, unsigned long end, bool max_capacity);
+        std::pair<Weight, Weight> get_max_capacity_path(Index start, Index end, std::vector<Index> &path);
 
-        
         /**
-         * @brief Increases the flow in the graph by a specified amount
-         * 
-         * @param start The starting point 
+         * @brief Calculates the pareto optimal path for a given ordering
+         *
+         * @param start The starting point
          * @param end The ending point
+         * @param order Which criterion takes precedence
+         * @return A list containing all the nodes in the optimal path, its capacity and its distance
+         * (number of hops, or total duration for PathOrder::DURATION_AWARE)
+         */
+        std::tuple<std::list<Index>, Weight, Weight> get_pareto_optimal_path(Index start, Index end, PathOrder order);
+
+        /**
+         * @brief Calculates the pareto optimal path for a given ordering, without allocating once warmed up
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param order Which criterion takes precedence
+         * @param path Replaced by the nodes in the optimal path
+         * @return The capacity and the distance of the path
+         */
+        std::pair<Weight, Weight> get_pareto_optimal_path(Index start, Index end, PathOrder order, std::vector<Index> &path);
+
+        /**
+         * @brief Calculates the path that holds the most people in a group among those that last at most a budget
+         *
+         * Labels are settled by decreasing capacity, so a label is dominated by every label already settled at its
+         * node with a shorter duration. Labels that can't reach the destination within the budget, according to the
+         * shortest remaining duration from each node, are dropped before being queued.
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param budget The maximum total duration
+         * @return A list containing all the nodes in the optimal path, its capacity and its total duration,
+         * the list being empty if no path fits the budget
+         */
+        std::tuple<std::list<Index>, Weight, Weight> get_budgeted_path(Index start, Index end, Weight budget);
+
+
+        /**
+         * @brief Increases the flow in the graph by a specified amount
+         *
+         * @param start The starting point, as an internal id
+         * @param end The ending point, as an internal id
          * @param flow_increase The amount to increase the flow
          */
-        void edmonds_karp(unsigned long start, unsigned long end, unsigned long flow_increase);
+        void edmonds_karp(Index start, Index end, Weight flow_increase);
+
+        /**
+         * @brief Tops the flow up to a maximum flow with Dinic's algorithm
+         *
+         * Each phase levels the residual graph with one BFS, then saturates every shortest path with a depth-first
+         * search that resumes each node's scan at its current arc. Compressed lists are decoded again up to the
+         * current arc on each resume, which suits their short lists.
+         *
+         * @param start The starting point, as an internal id
+         * @param end The ending point, as an internal id
+         */
+        void blocking_flow(Index start, Index end);
+
+        /**
+         * @brief Tops the flow up to a maximum flow by capacity scaling
+         *
+         * Runs blocking flow over the residual edges of at least a threshold, starting from the biggest power of
+         * two up to the biggest capacity and halved whenever no such path is left, so the widest paths go first.
+         * Without the profile, it's plain blocking flow.
+         *
+         * @param start The starting point, as an internal id
+         * @param end The ending point, as an internal id
+         */
+        void capacity_scaling(Index start, Index end);
+
+        /**
+         * @brief Increases the flow with the engine picked for this graph
+         *
+         * Only Edmonds-Karp stops at a given increase, so it's always used for a bounded one. The engine and why it
+         * was picked are recorded in the calling thread's engine_report().
+         *
+         * @param start The starting point, as an internal id
+         * @param end The ending point, as an internal id
+         * @param flow_increase The amount to increase the flow, the maximum value for as much as possible
+         * @param routed Whether the flow is handed out as the route of a group, see choose_flow_engine
+         */
+        void max_flow(Index start, Index end, Weight flow_increase, bool routed);
 
         /**
          * @brief Reads the flow path from the graph
-         * 
-         * @return A list containing all the start and end nodes and their respective flows in the current state
+         *
+         * @return A list containing all the start and end nodes and their respective flows in the current state,
+         * ordered by origin, then destination, then flow
+         */
+        std::list<std::tuple<Index, Index, Weight>> get_flow_path();
+
+        /**
+         * @brief Reads the flow path from the graph into a buffer, which is reused without allocating once it
+         * has grown to the number of edges with flow
+         *
+         * @param path Replaced by the start and end nodes of each edge with flow and its flow, ordered by origin,
+         * then destination, then flow
          */
-        std::list<std::tuple<unsigned long, unsigned long, unsigned long>> get_flow_path();
+        void get_flow_path(std::vector<std::tuple<Index, Index, Weight>> &path);
 
         /**
          * @brief Gets the path from the graph for a group of certain size
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @param size The size of the group
          * @return A list containing all the start and end nodes and their respective flows in the current state
          */
-        std::list<std::tuple<unsigned long, unsigned long, unsigned long>> get_path_for_group_of_size(unsigned long start, unsigned long end, unsigned long size);
+        std::list<std::tuple<Index, Index, Weight>> get_path_for_group_of_size(Index start, Index end, Weight size);
+
+        /** @brief Like the above, reading the flow path into a reusable buffer */
+        void get_path_for_group_of_size(Index start, Index end, Weight size, std::vector<std::tuple<Index, Index, Weight>> &path);
 
         /**
          * @brief Gets the path with a certain increment
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @param increment The increment value
          * @return A list containing all the start and end nodes and their respective flows in the current state
          */
-        std::list<std::tuple<unsigned long, unsigned long, unsigned long>> get_path_with_increment(unsigned long start, unsigned long end, unsigned long increment);
+        std::list<std::tuple<Index, Index, Weight>> get_path_with_increment(Index start, Index end, Weight increment);
+
+        /** @brief Like the above, reading the flow path into a reusable buffer */
+        void get_path_with_increment(Index start, Index end, Weight increment, std::vector<std::tuple<Index, Index, Weight>> &path);
 
         /**
          * @brief Gets the path for a group with the max possible size
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @return A list containing all the start and end nodes and their respective flows in the current state
          */
-        std::list<std::tuple<unsigned long, unsigned long, unsigned long>> get_path_for_group_of_max_size(unsigned long start, unsigned long end);
+        std::list<std::tuple<Index, Index, Weight>> get_path_for_group_of_max_size(Index start, Index end);
+
+        /** @brief Like the above, reading the flow path into a reusable buffer */
+        void get_path_for_group_of_max_size(Index start, Index end, std::vector<std::tuple<Index, Index, Weight>> &path);
 
 
         /**
          * @brief Get the earliest time at which a group of people would meetup again at a given destination
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @return The time at which the group would meetup again
          */
-        unsigned long get_earliest_meetup(unsigned long start, unsigned long end);
+        Weight get_earliest_meetup(Index start, Index end);
 
         /**
          * @brief Get the places and durations of where people will have to wait for others in order to proceed with their trip
-         * 
+         *
          * @param start The starting point
          * @param end The ending point
          * @return A list of indexes of where the person will have to wait and the respective durations
          */
-        std::list<std::pair<unsigned long, unsigned int>> get_waiting_periods(unsigned long start, unsigned long end);
+        std::list<std::pair<Index, Weight>> get_waiting_periods(Index start, Index end);
+
+        /**
+         * @brief Get the places and durations of where people will have to wait, into a buffer which is reused
+         * without allocating once it has grown to the number of such places
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param waiting_periods Replaced by the nodes where people wait and the respective durations, in id order
+         */
+        void get_waiting_periods(Index start, Index end, std::vector<std::pair<Index, Weight>> &waiting_periods);
+
+        /**
+         * @brief Alters the graph to contain the widest paths in the residual graph of the current flow
+         *
+         * Afterwards, a node's capacity is the most flow that could still be sent to it from start, and its
+         * flow_increase is the most flow it could still send to end. Nodes reachable from start are visited.
+         *
+         * @param start The starting point, as an internal id
+         * @param end The ending point, as an internal id
+         */
+        void residual_widest_paths(Index start, Index end);
+
+        /**
+         * @brief Gets the minimum cut of the maximum flow between two points
+         *
+         * The maximum flow is found from scratch, and the current flow is left as it was.
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @return The origin, destination and capacity of every edge in the cut
+         */
+        std::list<std::tuple<Index, Index, Weight>> get_min_cut(Index start, Index end);
+
+        /**
+         * @brief Gets the edges where more capacity would raise the maximum dimension of a group
+         *
+         * These are the saturated edges whose origin can still be reached from start and whose destination
+         * can still reach end in the residual graph, so one extra seat on them raises the maximum flow by one.
+         * The gain of an edge is the widest residual path through it: the flow increase obtainable by adding
+         * capacity to that edge alone is at least 1 and at most the gain.
+         * The maximum flow is found from scratch, and the current flow is left as it was.
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @return The origin, destination and gain of every critical edge, from the biggest gain to the smallest
+         */
+        std::list<std::tuple<Index, Index, Weight>> get_critical_edges(Index start, Index end);
+
+        /**
+         * @brief Gets both the minimum cut and the critical edges between two points, from a single maximum flow
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param cut Replaced by the minimum cut, as get_min_cut gives it
+         * @param critical Replaced by the critical edges, as get_critical_edges gives them
+         */
+        void get_bottlenecks(Index start, Index end, std::list<std::tuple<Index, Index, Weight>> &cut, std::list<std::tuple<Index, Index, Weight>> &critical);
+
+        /**
+         * @brief Calculates, for each edge of the maximum capacity path, the best path if that edge is cancelled
+         *
+         * Instead of one search per cancelled edge, this runs a widest path search from start, another one to end,
+         * and then a single sweep over the edges. Each edge leaving the part of the forward tree that hangs before a
+         * cancelled edge and entering the part that hangs after it bridges that cancellation; the widest bridge wins.
+         * Edges that are already inactive are ignored.
+         * This relies on the graph being acyclic, as every dataset is, so that no path to end can go back through
+         * the cancelled edge.
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @return The replacement path for each edge of the maximum capacity path, in the order of that path
+         */
+        std::vector<BasicReplacementPath<Index, Weight>> get_replacement_paths(Index start, Index end);
 
 };
+
+/** @brief Compact graph, used whenever the dataset fits in 32-bit ids and weights */
+using Graph = BasicGraph<uint32_t, uint32_t>;
+
+/** @brief Wide graph, used for datasets whose values overflow the compact graph */
+using WideGraph = BasicGraph<uint64_t, uint64_t>;
+
+using Edge = Graph::Edge;
+
+/** @brief A graph of either width, chosen at load time */
+using AnyGraph = std::variant<Graph, WideGraph>;
+
+/**
+ * @brief Builds the most compact graph able to hold the given file
+ *
+ * @param file The dataset file
+ * @param order The order to renumber the nodes in
+ * @return A compact Graph if every value fits in 32 bits, a WideGraph otherwise
+ */
+AnyGraph load_graph(const File &file, NodeOrder order = NodeOrder::FILE);
+
+/**
+ * @brief Reads the name of a node order, as given on the command line
+ *
+ * @param name file, bfs, topological or rcm
+ * @return The order
+ */
+NodeOrder parse_node_order(const std::string &name);
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+
+// Per-edge flows stored in fixed-size chunks that are shared between copies and copied on write
+// Copying an overlay costs O(edges / CHUNK_SIZE) and each later write copies at most one chunk
+// A missing chunk stands for a run of edges with no flow
+template <class V>
+class FlowOverlay {
+public:
+    static constexpr std::size_t CHUNK_SIZE = 256;
+
+private:
+    using Chunk = std::array<V, CHUNK_SIZE>;
+
+    std::size_t count = 0;                   // Number of edges covered by the overlay
+    std::vector<std::shared_ptr<Chunk>> chunks; // The chunks, nullptr when every flow in it is 0
+
+public:
+    FlowOverlay() = default;
+    explicit FlowOverlay(std::size_t n);     // Create an overlay for n edges, all with no flow
+    std::size_t size() const;                // Return number of edges covered
+    void resize(std::size_t n);              // Grow or shrink the overlay, new edges have no flow
+    V get(std::size_t e) const;              // Return the flow of edge e
+    void set(std::size_t e, const V& flow);  // Set the flow of edge e, copying its chunk if it is shared
+    void clear();                            // Set every flow to 0, reusing the chunks this overlay owns
+    template <class I, class A>
+    void nonzero(std::vector<I, A> &edges) const; // Append the ids of the edges with flow, in id order
+    std::size_t owned_chunks() const;        // Return number of chunks this overlay does not share with others
+    std::size_t memory_usage() const;        // Return bytes held by the chunks and the pointers to them
+};
+
+// ----------------------------------------------
+
+// Create an overlay for n edges, all with no flow
+template <class V>
+FlowOverlay<V>::FlowOverlay(std::size_t n) {
+    resize(n);
+}
+
+// Return number of edges covered
+template <class V>
+std::size_t FlowOverlay<V>::size() const {
+    return count;
+}
+
+// Grow or shrink the overlay, new edges have no flow
+template <class V>
+void FlowOverlay<V>::resize(std::size_t n) {
+    count = n;
+    chunks.resize((n + CHUNK_SIZE - 1) / CHUNK_SIZE);
+}
+
+// Return the flow of edge e
+template <class V>
+V FlowOverlay<V>::get(std::size_t e) const {
+    const std::shared_ptr<Chunk> &chunk = chunks[e / CHUNK_SIZE];
+    return chunk ? (*chunk)[e % CHUNK_SIZE] : V();
+}
+
+// Set the flow of edge e, copying its chunk if it is shared
+template <class V>
+void FlowOverlay<V>::set(std::size_t e, const V& flow) {
+    std::shared_ptr<Chunk> &chunk = chunks[e / CHUNK_SIZE];
+
+    if (!chunk) {
+        if (flow == V()) return; // already 0, nothing to store
+        chunk = std::make_shared<Chunk>();
+        chunk->fill(V());
+    } else if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+
+    (*chunk)[e % CHUNK_SIZE] = flow;
+}
+
+// Set every flow to 0, reusing the chunks this overlay owns
+template <class V>
+void FlowOverlay<V>::clear() {
+    for (std::shared_ptr<Chunk> &chunk : chunks) {
+        if (chunk && chunk.use_count() == 1) chunk->fill(V());
+        else chunk.reset();
+    }
+}
+
+// Append the ids of the edges with flow, in id order
+// Chunks with no flow are skipped whole, and each chunk is compacted without branches, writing every id and only
+// advancing past the ones with flow, which compilers can vectorize
+template <class V>
+template <class I, class A>
+void FlowOverlay<V>::nonzero(std::vector<I, A> &edges) const {
+    std::size_t used = edges.size();
+
+    for (std::size_t c = 0; c < chunks.size(); c++) {
+        if (!chunks[c]) continue;
+
+        const Chunk &chunk = *chunks[c];
+        std::size_t base = c * CHUNK_SIZE;
+        std::size_t limit = std::min(CHUNK_SIZE, count - base);
+
+        edges.resize(used + limit);
+        I *out = edges.data() + used;
+        for (std::size_t i = 0; i < limit; i++) {
+            *out = (I) (base + i);
+            out += chunk[i] != V();
+        }
+
+        used = out - edges.data();
+    }
+
+    edges.resize(used);
+}
+
+// Return number of chunks this overlay does not share with others
+template <class V>
+std::size_t FlowOverlay<V>::owned_chunks() const {
+    std::size_t owned = 0;
+    for (const std::shared_ptr<Chunk> &chunk : chunks) {
+        if (chunk && chunk.use_count() == 1) owned++;
+    }
+
+    return owned;
+}
+
+// Return bytes held by the chunks and the pointers to them
+template <class V>
+std::size_t FlowOverlay<V>::memory_usage() const {
+    std::size_t bytes = chunks.capacity() * sizeof(std::shared_ptr<Chunk>);
+    for (const std::shared_ptr<Chunk> &chunk : chunks) {
+        if (chunk) bytes += sizeof(Chunk);
+    }
+
+    return bytes;
+}
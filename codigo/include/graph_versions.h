@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "entities/graph.h"
+
+/** @brief A published dataset, which never changes once readers can see it */
+struct GraphVersion {
+    AnyGraph graph;
+
+    /** @brief The name of the dataset, which is its file unless it was registered under another */
+    std::string name;
+
+    uint64_t number;
+};
+
+/**
+ * @brief The current version of the dataset, replaced without stopping the queries that are using it
+ *
+ * Readers acquire the current version, a single atomic load of a shared pointer, and hold it for as long as
+ * their query runs. Publishing swaps that pointer, so queries already running finish on the old version while
+ * the next ones get the new one.
+ *
+ * Replaced versions are retired rather than dropped, and the loading thread frees each of them once no reader
+ * holds it anymore, so a reader never pays for freeing a whole graph. On Linux that thread also runs at a lower
+ * priority, so that parsing and building a dataset mostly uses time the readers leave.
+ *
+ * Versions are immutable: a reader that changes flows works on a copy of the graph, which shares the topology
+ * and only copies the chunks of flows it writes.
+ */
+class GraphVersions {
+    std::atomic<std::shared_ptr<const GraphVersion>> current;
+    std::atomic<uint64_t> published{0};
+
+    std::mutex retired_mutex;
+    std::vector<std::shared_ptr<const GraphVersion>> retired;
+
+    std::thread loader;
+    std::atomic<bool> loading{false};
+    std::atomic<bool> superseded{false};
+    std::atomic<bool> stopping{false};
+
+    std::mutex error_mutex;
+    std::string error;
+
+    /**
+     * @brief Builds a graph and publishes it, then waits for the versions it replaced to be released
+     *
+     * @param build Builds the graph
+     * @param name The name of the dataset
+     */
+    void run_loader(std::function<AnyGraph()> build, std::string name);
+
+    public:
+        GraphVersions() = default;
+
+        /** @brief Waits for the loading thread, freeing every version */
+        ~GraphVersions();
+
+        GraphVersions(const GraphVersions &) = delete;
+        GraphVersions &operator=(const GraphVersions &) = delete;
+
+        /**
+         * @brief Gets the current version, which stays valid for as long as it's held
+         *
+         * @return The version, or nullptr if none was published yet
+         */
+        std::shared_ptr<const GraphVersion> acquire() const;
+
+        /**
+         * @brief Gets the number of the current version, which grows with each publication
+         *
+         * @return The number, 0 if none was published yet
+         */
+        uint64_t get_version() const;
+
+        /**
+         * @brief Makes a graph the current version, retiring the previous one
+         *
+         * Only one thread may publish at a time, which is why loads in the background don't overlap.
+         *
+         * @param graph The graph
+         * @param name The name of its dataset
+         */
+        void publish(AnyGraph graph, const std::string &name);
+
+        /**
+         * @brief Starts loading a dataset on another thread, to be published once it's built
+         *
+         * @param file The dataset file
+         * @param order The order to renumber the nodes in
+         * @return false if another dataset is still loading, in which case nothing is started
+         */
+        bool load_in_background(const std::string &file, NodeOrder order);
+
+        /**
+         * @brief Starts building a graph on another thread, to be published once it's built
+         *
+         * @param build Builds the graph, throwing if it can't
+         * @param name The name of its dataset
+         * @return false if another dataset is still loading, in which case nothing is started
+         */
+        bool build_in_background(std::function<AnyGraph()> build, const std::string &name);
+
+        /**
+         * @brief Tells whether a dataset is being loaded, which ends once it's published
+         *
+         * @return true if it is
+         */
+        bool is_loading() const;
+
+        /**
+         * @brief Waits until the dataset being loaded, if any, is published and the versions it replaced are freed
+         *
+         * Only returns once nobody holds those versions, so the caller must not be holding one itself.
+         */
+        void wait();
+
+        /**
+         * @brief Gets why the last background load failed, clearing it
+         *
+         * @return The error, empty if there was none
+         */
+        std::string take_error();
+
+        /**
+         * @brief Frees the retired versions no reader holds anymore
+         *
+         * @return The number of retired versions still held
+         */
+        size_t reclaim();
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How large arrays ask for huge pages
+ *
+ * OFF leaves them to the allocator. TRANSPARENT maps them aligned to a huge page and advises the kernel to back
+ * them with transparent huge pages. EXPLICIT first tries the reserved pool of huge pages (MAP_HUGETLB), which
+ * is empty unless vm.nr_hugepages was raised, and falls back to TRANSPARENT.
+ */
+enum class HugePages {
+    OFF,
+    TRANSPARENT,
+    EXPLICIT
+};
+
+/** @brief What the arrays allocated through huge_allocate got */
+struct HugePageReport {
+    /** @brief The arrays currently mapped for huge pages, and their bytes */
+    size_t regions;
+    size_t bytes;
+
+    /** @brief The bytes taken from the reserved pool */
+    size_t explicit_bytes;
+
+    /** @brief The bytes the kernel accepted the advice for */
+    size_t advised_bytes;
+
+    /** @brief The bytes the kernel actually backs with transparent huge pages, from /proc/self/smaps */
+    size_t transparent_bytes;
+};
+
+/** @brief Arrays smaller than this are left to the allocator, as they couldn't fill a huge page */
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+/**
+ * @brief Chooses how arrays allocated from now on ask for huge pages
+ *
+ * Arrays already allocated keep their pages.
+ *
+ * @param mode The mode
+ */
+void set_huge_pages(HugePages mode);
+
+/** @brief Gets the mode arrays are allocated with */
+HugePages get_huge_pages();
+
+/**
+ * @brief Reads the name of a mode, as given on the command line
+ *
+ * @param name off, transparent or explicit
+ * @return The mode
+ * @throws std::invalid_argument if the name is unknown
+ */
+HugePages parse_huge_pages(const std::string &name);
+
+/**
+ * @brief Allocates an array, from huge pages if it's big enough and the mode asks for them
+ *
+ * Falls back to smaller pages whenever the kernel refuses, so it only fails when memory runs out.
+ *
+ * @param bytes The size of the array
+ * @return The array
+ * @throws std::bad_alloc if memory ran out
+ */
+void *huge_allocate(size_t bytes);
+
+/**
+ * @brief Frees an array allocated by huge_allocate
+ *
+ * @param array The array
+ * @param bytes The size it was allocated with
+ */
+void huge_deallocate(void *array, size_t bytes);
+
+/** @brief Describes the arrays currently allocated for huge pages */
+HugePageReport huge_page_report();
+
+/**
+ * @brief Allocator for the large arrays of a graph, whose random accesses otherwise miss the TLB on most reads
+ */
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    HugePageAllocator() = default;
+
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(huge_allocate(n * sizeof(T))); }
+    void deallocate(T *array, size_t n) { huge_deallocate(array, n * sizeof(T)); }
+
+    template <class U>
+    bool operator==(const HugePageAllocator<U> &) const { return true; }
+};
+
+/** @brief A vector whose storage may be backed by huge pages */
+template <class T>
+using HugeVector = std::vector<T, HugePageAllocator<T>>;
@@ -129,7 +129,7 @@ T read_value(const std::string prompt, const std::string warning, const std::fun
             is_input_valid = std::cin.peek() != '\n'
                              && std::cin >> result && std::cin.peek() == '\n'
                              && validator(result);
-        } catch (validation_error exception) {
+        } catch (const validation_error &exception) {
             error = exception.what();
         }
 
@@ -1,15 +1,16 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+
+#include "huge_pages.h"
+#include "stats.h"
 
 #define LEFT(i) (2*(i))
 #define RIGHT(i) (2*(i)+1)
 #define PARENT(i) ((i)/2)
 
-using namespace std;
-
-// Binary min-heap to represent integer keys of type K with values (priorities) of type V
+// Binary max-heap to represent integer keys of type K with values (priorities) of type V
+// Keys must lie in [0, n], as they index the position table directly
 template <class K, class V>
 class MaxHeap {
     struct Node { // An element of the heap: a pair (key, value)
@@ -17,30 +18,32 @@ class MaxHeap {
         V value;
     };
 
-    int size;                  // Number of elements in heap
-    int max_size;               // Maximum number of elements in heap
-    vector<Node> a;            // The heap array
-    unordered_map<K, int> pos; // maps a key into its position on the array a
-    const K KEY_NOT_FOUND;
+    K size;                    // Number of elements in heap
+    K max_size;                // Maximum number of elements in heap
+    HugeVector<Node> a;        // The heap array
+    HugeVector<K> pos;         // maps a key into its position on the array a (0 when absent)
+    K KEY_NOT_FOUND;
 
-    void up_heap(int i);
-    void down_heap(int i);
-    void swap(int i1, int i2);
+    void up_heap(K i);
+    void down_heap(K i);
+    void swap(K i1, K i2);
 
 public:
-    MaxHeap(int n, const K& not_found); // Create a min-heap for a max of n pairs (K,V) with notFound returned when empty
-    int get_size();              // Return number of elements in the heap
+    MaxHeap();                   // Create an empty max-heap, to be sized by reset
+    MaxHeap(K n, const K& not_found); // Create a max-heap for a max of n pairs (K,V) with notFound returned when empty
+    void reset(K n);             // Empty the heap and make room for keys up to n, reusing its arrays
+    K get_size();                // Return number of elements in the heap
     bool has_key(const K& key);  // Heap has key?
     void insert(const K& key, const V& value);      // Insert (key, value) on the heap
-    void increase_key(const K& key, const V& value); // Decrease value of key
-    K remove_max(); // remove and return key with smaller value
+    void increase_key(const K& key, const V& value); // Increase value of key
+    K remove_max(); // remove and return key with bigger value
 };
 
 // ----------------------------------------------
 
 // Make a value go "up the tree" until it reaches its position
 template <class K, class V>
-void MaxHeap<K,V>::up_heap(int i) {
+void MaxHeap<K,V>::up_heap(K i) {
     while (i>1 && a[i].value > a[PARENT(i)].value) { // while pos bigger than parent, keep swapping to upper position
         swap(i, PARENT(i));
         i = PARENT(i);
@@ -49,19 +52,19 @@ void MaxHeap<K,V>::up_heap(int i) {
 
 // Make a value go "down the tree" until it reaches its position
 template <class K, class V>
-void MaxHeap<K,V>::down_heap(int i) {
+void MaxHeap<K,V>::down_heap(K i) {
     while (LEFT(i) <= size) { // while within heap limits
-        int j = LEFT(i);
-        if (RIGHT(i)<=size && a[RIGHT(i)].value > a[j].value) j = RIGHT(i); // choose smaller child
-        if (a[i].value > a[j].value) break;   // node already smaller than children, stop
-        swap(i, j);                    // otherwise, swap with smaller child
+        K j = LEFT(i);
+        if (RIGHT(i)<=size && a[RIGHT(i)].value > a[j].value) j = RIGHT(i); // choose bigger child
+        if (a[i].value > a[j].value) break;   // node already bigger than children, stop
+        swap(i, j);                    // otherwise, swap with bigger child
         i = j;
     }
 }
 
 // Swap two positions of the heap (update their positions)
 template <class K, class V>
-void MaxHeap<K,V>::swap(int i1, int i2) {
+void MaxHeap<K,V>::swap(K i1, K i2) {
     Node tmp = a[i1]; a[i1] = a[i2]; a[i2] = tmp;
     pos[a[i1].key] = i1;
     pos[a[i2].key] = i2;
@@ -69,21 +72,40 @@ void MaxHeap<K,V>::swap(int i1, int i2) {
 
 // ----------------------------------------------
 
-// Create a min-heap for a max of n pairs (K,V) with notFound returned when empty
+// Create a max-heap for a max of n pairs (K,V) with notFound returned when empty
+template <class K, class V>
+MaxHeap<K,V>::MaxHeap(K n, const K& notFound) : size(0), max_size(n), a(n+1), pos(n+1, 0), KEY_NOT_FOUND(notFound) {
+}
+
+// Create an empty max-heap, to be sized by reset
 template <class K, class V>
-MaxHeap<K,V>::MaxHeap(int n, const K& notFound) : KEY_NOT_FOUND(notFound), size(0), max_size(n), a(n+1) {
+MaxHeap<K,V>::MaxHeap() : MaxHeap(0, 0) {
+}
+
+// Empty the heap and make room for keys up to n, reusing its arrays
+// Only the positions of the keys left in the heap are cleared, so a drained heap is reset in O(1)
+template <class K, class V>
+void MaxHeap<K,V>::reset(K n) {
+    for (K i = 1; i <= size; i++) pos[a[i].key] = 0;
+    size = 0;
+    max_size = n;
+
+    if (a.size() < (size_t) n + 1) {
+        a.resize(n + 1);
+        pos.resize(n + 1, 0);
+    }
 }
 
 // Return number of elements in the heap
 template <class K, class V>
-int MaxHeap<K,V>::get_size() {
+K MaxHeap<K,V>::get_size() {
     return size;
 }
 
 // Heap has key?
 template <class K, class V>
 bool MaxHeap<K, V>::has_key(const K& key) {
-    return pos.find(key) != pos.end();
+    return pos[key] != 0;
 }
 
 // Insert (key, value) on the heap
@@ -91,28 +113,34 @@ template <class K, class V>
 void MaxHeap<K,V>::insert(const K& key, const V& value) {
     if (size == max_size) return; // heap is full, do nothing
     if (has_key(key)) return;     // key already exists, do nothing
+    COUNT_STAT(heap_inserts);
     a[++size] = {key, value};
     pos[key] = size;
     up_heap(size);
 }
 
-// Decrease value of key to the indicated value
+// Increase value of key to the indicated value
 template <class K, class V>
 void MaxHeap<K,V>::increase_key(const K& key, const V& value) {
     if (!has_key(key)) return; // key does not exist, do nothing
-    int i = pos[key];
+    K i = pos[key];
     if (value < a[i].value) return; // value would decrease, do nothing
+    COUNT_STAT(heap_increase_keys);
     a[i].value = value;
     up_heap(i);
 }
 
-// remove and return key with smaller value
+// remove and return key with bigger value
 template <class K, class V>
 K MaxHeap<K,V>::remove_max() {
     if (size == 0) return KEY_NOT_FOUND;
+    COUNT_STAT(heap_pops);
     K max = a[1].key;
-    pos.erase(max);
+    pos[max] = 0;
     a[1] = a[size--];
-    down_heap(1);
+    if (size > 0) {
+        pos[a[1].key] = 1;
+        down_heap(1);
+    }
     return max;
 }
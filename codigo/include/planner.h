@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <unordered_map>
+
+#include "entities/graph.h"
+
+/** @brief A group of people travelling between two points, who may separate along the way */
+struct Group {
+    unsigned long start;
+    unsigned long end;
+    unsigned long size;
+};
+
+/**
+ * @brief The route found for a group
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for flows
+ */
+template <class Index, class Weight>
+struct BasicGroupRoute {
+    /** @brief The group this route is for */
+    Group group;
+
+    /** @brief How many people of the group could be routed */
+    Weight routed;
+
+    /** @brief The origin, destination and flow of each edge used by the group */
+    std::vector<std::tuple<Index, Index, Weight>> flow_path;
+};
+
+/**
+ * @brief Routes several groups at once over the same buses, so that they share their capacity
+ *
+ * Groups are routed in the order they were added, with augmenting paths over the capacity left by the
+ * groups before them. Groups that could not be fully routed then get rip-up-and-reroute rounds: the groups
+ * using the buses that block them are removed, the blocked group is routed, and the removed groups are
+ * routed again. The new plan is kept only if more people are routed in total.
+ *
+ * @tparam Index The type used for node and edge ids
+ * @tparam Weight The type used for capacities and flows
+ */
+template <class Index, class Weight>
+class BasicGroupPlanner {
+    using Graph = BasicGraph<Index, Weight>;
+    using Edge = typename Graph::Edge;
+    using GroupFlow = std::unordered_map<Index, Weight>;
+
+    /** @brief A complete assignment: the total flow of each edge and each group's share of it */
+    struct Plan {
+        Graph graph;
+        std::vector<GroupFlow> group_flows;
+        std::vector<Weight> routed;
+        Weight total = 0;
+    };
+
+    Plan plan;
+    std::vector<Group> groups;
+
+    /** @brief Search state, reused between searches */
+    std::vector<Index> parent;
+    std::vector<Weight> bottleneck;
+    std::vector<uint32_t> seen;
+    std::vector<Index> next;
+    uint32_t stamp = 0;
+
+    /** @brief Gets how many people of a group are to be routed */
+    Weight requested(size_t g) const;
+
+    /**
+     * @brief Searches for the shortest path with spare capacity for a group
+     *
+     * Other groups' flows can't be undone, but the group may redirect its own flow.
+     *
+     * @param plan The plan to search in
+     * @param g The index of the group
+     * @return true if the group's destination was reached
+     */
+    bool find_augmenting_path(const Plan &plan, size_t g);
+
+    /** @brief Like the above, over the given adjacency lists, plain or compressed */
+    template <class Lists>
+    bool find_augmenting_path(const Lists &adjacency, const Plan &plan, size_t g);
+
+    /**
+     * @brief Routes up to a given amount of people of a group
+     *
+     * @param plan The plan to route the group in
+     * @param g The index of the group
+     * @param amount The maximum number of people to route
+     * @return The number of people routed
+     */
+    Weight route(Plan &plan, size_t g, Weight amount);
+
+    /**
+     * @brief Removes a group from a plan, freeing the capacity it used
+     *
+     * @param plan The plan to remove the group from
+     * @param g The index of the group
+     */
+    void rip_up(Plan &plan, size_t g);
+
+    /**
+     * @brief Finds the groups using the saturated edges that keep a group from being routed further
+     *
+     * @param plan The plan to look in
+     * @param g The index of the blocked group
+     * @return The indexes of the blocking groups
+     */
+    std::vector<size_t> blocking_groups(const Plan &plan, size_t g);
+
+    public:
+
+        /**
+         * @brief Construct a new planner
+         *
+         * @param graph The graph to plan on, which is forked and so left untouched
+         */
+        BasicGroupPlanner(const BasicGraph<Index, Weight> &graph);
+
+        /**
+         * @brief Adds a group to be planned
+         *
+         * @param group The group, groups added first have priority
+         */
+        void add_group(const Group &group);
+
+        /**
+         * @brief Routes every group added so far
+         *
+         * @param rounds The number of rip-up-and-reroute rounds
+         * @return The route of each group, in the order they were added
+         */
+        std::vector<BasicGroupRoute<Index, Weight>> plan_groups(unsigned rounds = 2);
+
+        /**
+         * @brief Gets the graph holding the combined flow of every group
+         *
+         * @return The graph, with each edge's flow being the number of people of all groups on it
+         */
+        const Graph &get_graph() const;
+
+        /**
+         * @brief Gets the capacity left on the edges used by the plan
+         *
+         * @return The origin, destination and remaining capacity of each used edge
+         */
+        std::vector<std::tuple<Index, Index, Weight>> get_residual_capacity() const;
+};
+
+using GroupPlanner = BasicGroupPlanner<uint32_t, uint32_t>;
+using WideGroupPlanner = BasicGroupPlanner<uint64_t, uint64_t>;
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <initializer_list>
+#include <iosfwd>
+#include <vector>
+
+/** @brief How the results of the scenarios are written */
+enum class OutputFormat {
+    TEXT,
+    CSV,
+    JSON
+};
+
+/**
+ * @brief Writes the result of a query, as tables of numbers and named values, through a large buffer
+ *
+ * The result is only handed to the stream when the buffer fills up or the result is finished, so printing a
+ * big flow costs a few writes instead of a flush per line.
+ *
+ * In text, rows and values are written with a pattern where each {} is replaced by the next number, and
+ * headings are written with text(). CSV writes each table, and each value, as a header line followed by its
+ * rows, separating them with blank lines. JSON writes each result as one object in a line, with tables as
+ * arrays of objects. text() is ignored by CSV and JSON.
+ */
+class ResultWriter {
+    std::ostream &out;
+    OutputFormat format;
+
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    const char *row_pattern = "";
+    std::vector<const char *> columns;
+    bool first_field = true;
+    bool first_row = true;
+
+    /**
+     * @brief Makes room in the buffer, flushing it if needed
+     *
+     * @param bytes The number of bytes about to be written
+     */
+    void reserve(size_t bytes);
+
+    void put(const char *text, size_t length);
+    void put(const char *text);
+    void put(unsigned long value);
+
+    /** @brief Writes a number with two decimal places */
+    void put(double value);
+
+    /**
+     * @brief Writes a text pattern, replacing each {} with the next value
+     *
+     * @param pattern The pattern
+     * @param values The values
+     */
+    void put_pattern(const char *pattern, std::initializer_list<unsigned long> values);
+
+    /** @brief Separates a table or value from the previous one of the same result */
+    void begin_field(const char *name);
+
+    public:
+        /**
+         * @brief Creates a writer
+         *
+         * @param out The stream the results are written to
+         * @param format The format of the results
+         */
+        ResultWriter(std::ostream &out, OutputFormat format);
+
+        /** @brief Finishes the current result */
+        ~ResultWriter();
+
+        ResultWriter(const ResultWriter &) = delete;
+        ResultWriter &operator=(const ResultWriter &) = delete;
+
+        /**
+         * @brief Writes text that is only meant for people, such as headings
+         *
+         * @param text The text
+         */
+        void text(const char *text);
+
+        /**
+         * @brief Starts a table
+         *
+         * @param name The name of the table
+         * @param columns The names of its columns
+         * @param row_pattern How each row is written in text
+         */
+        void begin_table(const char *name, std::initializer_list<const char *> columns, const char *row_pattern);
+
+        /**
+         * @brief Writes a row of the current table
+         *
+         * @param values One value for each column
+         */
+        void row(std::initializer_list<unsigned long> values);
+
+        /** @brief Ends the current table */
+        void end_table();
+
+        /**
+         * @brief Writes a named value
+         *
+         * @param name The name of the value
+         * @param pattern How the value is written in text
+         * @param value The value
+         */
+        void value(const char *name, const char *pattern, unsigned long value);
+
+        /**
+         * @brief Writes a named value that isn't a whole number, such as a mean, with two decimal places
+         *
+         * @param name The name of the value
+         * @param pattern How the value is written in text
+         * @param value The value
+         */
+        void decimal(const char *name, const char *pattern, double value);
+
+        /** @brief Ends the current result and hands everything to the stream */
+        void finish();
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "entities/graph.h"
+
+/** @brief The distribution the fill factor of a bus is drawn from */
+enum class Perturbation {
+    UNIFORM,
+    NORMAL
+};
+
+/**
+ * @brief How the real capacity of a bus differs from its nominal capacity
+ *
+ * Each sample cancels a bus with the given probability and otherwise multiplies its capacity by a factor drawn
+ * from the distribution, which is kept between 0 and 1, since buses run under capacity but never over it.
+ */
+struct CapacityModel {
+    /** @brief The probability of a bus being cancelled */
+    double cancel_probability = 0;
+
+    /** @brief The distribution of the fill factor */
+    Perturbation distribution = Perturbation::UNIFORM;
+
+    /** @brief The bounds of the fill factor, for uniform distributions */
+    double low = 1, high = 1;
+
+    /** @brief The mean and standard deviation of the fill factor, for normal distributions */
+    double mean = 1, deviation = 0;
+};
+
+/**
+ * @brief The outcome of a simulation
+ *
+ * @tparam Weight The type used for capacities and durations
+ */
+template <class Weight>
+struct BasicSimulationResult {
+    /** @brief The maximum dimension of the group in each sample finished, sorted */
+    std::vector<Weight> max_sizes;
+
+    /** @brief The earliest meetup of each sample where the group could travel, sorted */
+    std::vector<Weight> meetups;
+
+    /**
+     * @brief Gets a percentile of a sorted distribution
+     *
+     * @param values The sorted values
+     * @param p The percentile, between 0 and 100
+     * @return The value below which p percent of the values lie, 0 if there are none
+     */
+    static Weight percentile(const std::vector<Weight> &values, double p);
+
+    /**
+     * @brief Gets the mean of a distribution
+     *
+     * @param values The values
+     * @return The mean, 0 if there are no values
+     */
+    static double mean(const std::vector<Weight> &values);
+};
+
+/**
+ * @brief Estimates the maximum dimension of a group and its earliest meetup when capacities are uncertain
+ *
+ * Samples run in parallel, each thread through its own copy of the graph, which shares the topology rather than
+ * copying it. The sampled capacities are set on that copy, so the maximum flow and the meetup are found by the
+ * same searches as Scenarios 2.3 and 2.4, and its flows and search state are reused from one sample to the next.
+ * Every sample draws from its own random stream, derived from the seed and the sample number, so the results
+ * only depend on the seed and not on the number of threads.
+ *
+ * @tparam Index The type used for node and edge ids
+ * @tparam Weight The type used for capacities and durations
+ */
+template <class Index, class Weight>
+class BasicCapacitySimulator {
+    using Graph = BasicGraph<Index, Weight>;
+
+    Graph graph;
+    CapacityModel model;
+
+    /**
+     * @brief Draws the capacity of every bus for a sample
+     *
+     * @param capacities The capacity of each edge, overwritten
+     * @param seed The seed of the simulation
+     * @param sample The number of the sample
+     */
+    void draw_capacities(HugeVector<Weight> &capacities, uint64_t seed, uint64_t sample) const;
+
+    /**
+     * @brief Gets the size of the flow of a graph, as what leaves the starting point minus what comes back to it
+     *
+     * @param graph The graph
+     * @param start The starting point, as an internal id
+     * @return The size of the flow
+     */
+    static Weight flow_size(const Graph &graph, Index start);
+
+    public:
+
+        /**
+         * @brief Construct a new simulator
+         *
+         * @param graph The graph to simulate on, whose topology is shared and whose flow is left out
+         * @param model How capacities are perturbed
+         */
+        BasicCapacitySimulator(const BasicGraph<Index, Weight> &graph, const CapacityModel &model);
+
+        /**
+         * @brief Runs the simulation
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param samples The number of samples
+         * @param seed The seed of the random streams
+         * @param threads The number of threads, 0 for one per core
+         * @param token Stops drawing samples once cancelled or out of time, the result then covering the samples
+         * finished by then
+         * @return The distribution of the maximum dimension and of the earliest meetup
+         */
+        BasicSimulationResult<Weight> simulate(Index start, Index end, uint64_t samples, uint64_t seed, unsigned threads = 0,
+                                               const CancellationToken &token = CancellationToken()) const;
+};
+
+using CapacitySimulator = BasicCapacitySimulator<uint32_t, uint32_t>;
+using WideCapacitySimulator = BasicCapacitySimulator<uint64_t, uint64_t>;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "entities/graph.h"
+
+/**
+ * @brief What a snapshot holds, read from the start of its file
+ *
+ * A snapshot is a built graph written as raw arrays: a fixed header, the edge columns, when nodes were
+ * renumbered, the map back to the ids of the dataset, and the profile of the graph with its topological order.
+ * Loading one skips parsing and only rebuilds the adjacency lists, which are derived from the edges. Values are written in the byte order of the machine, so snapshots
+ * are meant to be read where they were written.
+ */
+struct SnapshotInfo {
+    /** @brief Whether the graph is a WideGraph */
+    bool wide;
+
+    /** @brief The order its nodes were renumbered in */
+    NodeOrder order;
+
+    uint64_t nodes;
+    uint64_t edges;
+};
+
+/**
+ * @brief Reads the header of a snapshot
+ *
+ * @param path The file
+ * @param info Where the header is written
+ * @return false if the file can't be read or isn't a snapshot written on this machine
+ */
+bool read_snapshot_info(const std::string &path, SnapshotInfo &info);
+
+/**
+ * @brief Writes a graph as a snapshot, replacing the file only once it's complete
+ *
+ * @param graph The graph, whose flows aren't saved
+ * @param path The file
+ */
+void save_snapshot(const AnyGraph &graph, const std::string &path);
+
+/**
+ * @brief Loads a graph from a snapshot
+ *
+ * @param path The file
+ * @return The graph, with the width it was saved with and no flow
+ */
+AnyGraph load_snapshot(const std::string &path);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+/**
+ * @brief The work done by a query
+ *
+ * The counters are only updated when the program is built with TRAVEL_STATS. Otherwise COUNT_STAT expands to
+ * nothing, so the instrumented loops compile exactly as if it wasn't there.
+ */
+struct QueryStats {
+    uint64_t nodes_settled = 0;
+    uint64_t edges_relaxed = 0;
+    uint64_t heap_inserts = 0;
+    uint64_t heap_increase_keys = 0;
+    uint64_t heap_pops = 0;
+    uint64_t bfs_passes = 0;
+    uint64_t augmentations = 0;
+    uint64_t allocations = 0;
+    uint64_t bytes_allocated = 0;
+    double milliseconds = 0;
+
+    /**
+     * @brief Writes the counters as a line of text
+     *
+     * @param out The stream to write to
+     */
+    void print(std::ostream &out) const;
+
+    /**
+     * @brief Writes the counters as a JSON object on a single line
+     *
+     * @param out The stream to write to
+     */
+    void print_json(std::ostream &out) const;
+};
+
+/** @brief How the statistics of each query are shown */
+enum class StatsOutput {
+    NONE,
+    TEXT,
+    JSON
+};
+
+#ifdef TRAVEL_STATS
+
+/**
+ * @brief Gets the counters of the calling thread
+ *
+ * @return The counters
+ */
+inline QueryStats &query_stats() {
+    thread_local QueryStats stats;
+    return stats;
+}
+
+#define COUNT_STAT(counter) (++query_stats().counter)
+
+#else
+
+#define COUNT_STAT(counter) ((void) 0)
+
+#endif
+
+/**
+ * @brief Tells whether the program was built with TRAVEL_STATS
+ *
+ * @return true if the counters are updated
+ */
+bool stats_enabled();
+
+/** @brief Zeroes the calling thread's counters and starts timing a new query */
+void start_query_stats();
+
+/**
+ * @brief Gets the calling thread's counters since start_query_stats, along with the time and the allocations
+ *
+ * @return The counters, all 0 if the program was built without TRAVEL_STATS
+ */
+QueryStats finish_query_stats();
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <variant>
+
+#include "entities/graph.h"
+
+/**
+ * @brief A single scheduled trip, laid out flat so that a whole timetable is one contiguous array
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for times and capacities
+ */
+template <class Index, class Weight>
+struct BasicConnection {
+    Weight departure;
+    Weight arrival;
+    Index origin;
+    Index destination;
+    Weight capacity;
+};
+
+/**
+ * @brief The connections taken by a journey
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for times and capacities
+ */
+template <class Index, class Weight>
+struct BasicJourney {
+    /** @brief The connections, in the order they are taken, empty if there is no journey */
+    std::vector<BasicConnection<Index, Weight>> legs;
+
+    /** @brief The number of people the journey can take */
+    Weight capacity;
+
+    /** @brief The arrival at the destination */
+    Weight arrival;
+};
+
+/**
+ * @brief Answers timetable queries with connection scan
+ *
+ * Every trip is a connection, and all connections are kept in a single array sorted by departure. Queries scan
+ * that array once, from the first connection leaving after the given time, so memory is read sequentially and
+ * the array could as well be streamed from disk.
+ *
+ * @tparam Index The type used for node ids
+ * @tparam Weight The type used for times and capacities
+ */
+template <class Index, class Weight>
+class BasicTimetable {
+    public:
+        using Connection = BasicConnection<Index, Weight>;
+        using Journey = BasicJourney<Index, Weight>;
+
+    private:
+        Index n = 0;
+
+        /** @brief Every connection, sorted by departure and then by arrival */
+        std::vector<Connection> connections;
+
+        /** @brief Search state, reused between queries */
+        std::vector<Weight> best;
+        std::vector<Index> reached_by;
+        std::vector<Index> previous;
+
+        /**
+         * @brief Finds the first connection leaving at or after a time
+         *
+         * @param time The time
+         * @return The position of that connection
+         */
+        size_t first_departure(Weight time) const;
+
+        /**
+         * @brief Follows the connections that led to a node back to the start
+         *
+         * @param last The position of the last connection, or connections.size() if there is none
+         * @return The connections in the order they are taken
+         */
+        std::vector<Connection> get_legs(size_t last) const;
+
+    public:
+
+        /**
+         * @brief Construct a new empty timetable
+         */
+        BasicTimetable() = default;
+
+        /**
+         * @brief Construct a new timetable from the trips of a graph, inactive ones excluded
+         *
+         * @param graph The graph
+         */
+        explicit BasicTimetable(const BasicGraph<Index, Weight> &graph);
+
+        /**
+         * @brief Gets every connection, in the order they are scanned
+         *
+         * @return The connections, sorted by departure
+         */
+        const std::vector<Connection> &get_connections() const;
+
+        /**
+         * @brief Calculates the journey that arrives the earliest
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param time The time at which the start is left
+         * @return The journey, its capacity being the smallest of its connections
+         */
+        Journey get_earliest_arrival(Index start, Index end, Weight time);
+
+        /**
+         * @brief Calculates the journey that takes the most people and arrives by a deadline
+         *
+         * Arrivals only become usable once the scan reaches their time, so they are held back in a heap of pending
+         * arrivals until then; the scan itself still visits each connection once.
+         *
+         * @param start The starting point
+         * @param end The ending point
+         * @param time The time at which the start is left
+         * @param deadline The latest arrival
+         * @return The journey, empty if nobody can arrive by the deadline
+         */
+        Journey get_max_capacity_by_deadline(Index start, Index end, Weight time, Weight deadline);
+};
+
+using Timetable = BasicTimetable<uint32_t, uint32_t>;
+using WideTimetable = BasicTimetable<uint64_t, uint64_t>;
+
+/** @brief The timetable of a graph of either width, or none until it's first needed */
+using AnyTimetable = std::variant<std::monostate, Timetable, WideTimetable>;
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/** @brief A finished span: what ran, when it started and for how long, in nanoseconds */
+struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+/**
+ * @brief The spans recorded by one thread
+ *
+ * Only its own thread writes to a ring, so pushing is a plain store followed by a release of the new head,
+ * without locks. Once full, the oldest spans are overwritten.
+ */
+class TraceRing {
+    public:
+        static constexpr size_t CAPACITY = 1 << 16;
+
+    private:
+        std::array<TraceEvent, CAPACITY> events;
+        std::atomic<uint64_t> head{0};
+        uint32_t thread;
+
+    public:
+        explicit TraceRing(uint32_t thread);
+
+        /**
+         * @brief Records a span, called only by the ring's own thread
+         *
+         * @param event The span
+         */
+        void push(const TraceEvent &event);
+
+        /**
+         * @brief Copies the spans still held by the ring, oldest first
+         *
+         * @return The spans
+         */
+        std::vector<TraceEvent> snapshot() const;
+
+        /** @brief Gets the number of the thread that owns the ring */
+        uint32_t get_thread() const;
+};
+
+/**
+ * @brief Latencies grouped in buckets whose width grows with the value, like an HDR histogram
+ *
+ * Each power of two is split in 32 buckets, so any recorded value is known to within about 3% while the whole
+ * range of 64-bit nanoseconds fits in under 2000 counters.
+ */
+class LatencyHistogram {
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t maximum = 0;
+    double sum = 0;
+
+    static size_t bucket_of(uint64_t value);
+    static uint64_t value_of(size_t bucket);
+
+    public:
+
+        /**
+         * @brief Records a latency
+         *
+         * @param nanoseconds The latency
+         */
+        void record(uint64_t nanoseconds);
+
+        /**
+         * @brief Gets a percentile of the recorded latencies
+         *
+         * @param p The percentile, between 0 and 100
+         * @return The latency below which p percent of them lie, in nanoseconds
+         */
+        uint64_t percentile(double p) const;
+
+        /**
+         * @brief Adds the latencies recorded by another histogram
+         *
+         * @param other The histogram
+         */
+        void merge(const LatencyHistogram &other);
+
+        /** @brief Forgets every latency, keeping the counters allocated */
+        void clear();
+
+        uint64_t count() const;
+        uint64_t max() const;
+        double mean() const;
+};
+
+/**
+ * @brief Measures the wall time of a phase, from its construction to its destruction
+ *
+ * Spans are only recorded while tracing is enabled. Spans that are not nested in another span of the same thread
+ * also add up to the time of the current query, so user input between phases isn't counted.
+ */
+class TraceSpan {
+    const char *name;
+    uint64_t start;
+    bool recording;
+
+    public:
+        explicit TraceSpan(const char *name);
+        ~TraceSpan();
+
+        TraceSpan(const TraceSpan &) = delete;
+        TraceSpan &operator=(const TraceSpan &) = delete;
+};
+
+#ifdef TRAVEL_STATS
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+
+#else
+
+#define TRACE_SPAN(name) ((void) 0)
+
+#endif
+
+/**
+ * @brief Starts or stops recording spans
+ *
+ * @param enabled Whether spans are recorded
+ */
+void set_tracing(bool enabled);
+
+/**
+ * @brief Tells whether spans are being recorded
+ *
+ * @return true if they are
+ */
+bool tracing_enabled();
+
+/**
+ * @brief Starts a query of a scenario, whose spans are then added to that scenario's histograms
+ *
+ * @param scenario The name of the scenario
+ */
+void begin_traced_query(const std::string &scenario);
+
+/** @brief Ends the current query, recording its total time in its scenario's histogram */
+void end_traced_query();
+
+/**
+ * @brief Writes every recorded span as Chrome trace-event JSON, which chrome://tracing and Perfetto can open
+ *
+ * @param out The stream to write to
+ */
+void write_chrome_trace(std::ostream &out);
+
+/**
+ * @brief Writes the latency histograms of each scenario and of each of its phases as a table
+ *
+ * Each thread adds up its spans on its own, and hands them over when its query ends or when it exits, so the
+ * spans of threads still running, other than the calling one, are left out.
+ *
+ * @param out The stream to write to
+ */
+void write_latency_histograms(std::ostream &out);
@@ -2,16 +2,43 @@
 
 #include "interact.h"
 #include "entities/graph.h"
+#include "stats.h"
+#include "result_writer.h"
+#include "graph_versions.h"
+#include "dataset_registry.h"
+#include "timetable.h"
 
+#include <chrono>
+#include <fstream>
 #include <vector>
 #include <string>
 
 class UI {
-    Graph graph;
+    /** @brief Declared before the versions, whose loading thread may still be reading from it when they're destroyed */
+    DatasetRegistry datasets;
+    GraphVersions versions;
+
+    /** @brief The version the queries run on, and the copy of its graph whose flows they change */
+    std::shared_ptr<const GraphVersion> version;
+    AnyGraph graph;
+
+    /** @brief The timetable of the version, built by the first timetable query on it, as sorting it is the slow part */
+    AnyTimetable timetable;
+
     bool is_running = true;
     bool scenario_two_executed = false;
 
-    bool sort;
+    OutputFormat format;
+    StatsOutput stats;
+    NodeOrder order;
+    std::ofstream output;
+
+    /** @brief How long a query may search, 0 for no limit, and the token of the running one */
+    std::chrono::milliseconds query_timeout;
+    CancellationToken query_token;
+
+    /** @brief Whether each scenario is followed by the engines it ran on, why and what they cost */
+    bool explain;
 
     /**
      * @brief Lets the user pick the file where to get the data from
@@ -49,11 +76,74 @@ class UI {
      */
     std::pair<unsigned long, unsigned long> choose_starting_and_ending_nodes();
 
+    /**
+     * @brief Makes each option of a block run under its own cancellation token, stopped by Ctrl-C or the query
+     * timeout, and report the statistics of its query and feed the latency histograms, if they were asked for
+     * 
+     * @param block The block with the scenarios
+     * @return The block with the wrapped scenarios
+     */
+    MenuBlock instrument(const MenuBlock &block);
+
+    /**
+     * @brief Makes the queries run on a registered dataset, loading it if it isn't resident
+     * 
+     * @param name The name of the dataset
+     */
+    void load(const std::string &name);
+
+    /**
+     * @brief Starts moving the queries to a registered dataset, which is loaded in the background if needed
+     * 
+     * @param name The name of the dataset
+     */
+    void switch_to(const std::string &name);
+
+    /**
+     * @brief Lets the user pick one of the registered datasets
+     * 
+     * @return The name of the dataset
+     */
+    std::string choose_dataset();
+
+    /**
+     * @brief Moves the queries to the latest version of the dataset, if one was loaded in the background since
+     * the last call, and reports loads that failed
+     * 
+     * Called between queries, so a query never sees the dataset change under it.
+     */
+    void refresh();
+
+    /**
+     * @brief Gets where the results of the scenarios are written
+     * 
+     * @return The output file, if one was given, or the standard output
+     */
+    std::ostream &results();
+
     public:
         /**
          * @brief Displays the menu
          */
         void start();
 
-        UI(bool sort = true);
+        /**
+         * @brief Creates the interface, asking for the dataset
+         * 
+         * @param format The format of the results
+         * @param stats How the statistics of each query are reported
+         * @param output_file Where the results are written, the standard output if empty
+         * @param order The order nodes are renumbered in when a dataset is loaded
+         * @param named_datasets Datasets to register, as name and file, the first one being used at the start
+         * instead of asking for a file
+         * @param memory_budget The bytes resident datasets may hold, 0 for no limit
+         * @param snapshot_dir Where text datasets are cached as snapshots, empty for nowhere
+         * @param compress Whether the adjacency lists of each dataset are compressed once it's loaded
+         * @param query_timeout How long each query may search before it returns what it found so far, 0 for no limit
+         * @param explain Whether each scenario is followed by the engines it ran on, why and what they cost
+         */
+        UI(OutputFormat format = OutputFormat::TEXT, StatsOutput stats = StatsOutput::NONE, const std::string &output_file = "",
+           NodeOrder order = NodeOrder::FILE, const std::vector<std::pair<std::string, std::string>> &named_datasets = {},
+           size_t memory_budget = 0, const std::string &snapshot_dir = "", bool compress = false,
+           std::chrono::milliseconds query_timeout = std::chrono::milliseconds::zero(), bool explain = false);
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * @brief Worker processes that answer requests, sharing the memory the parent had when they were forked
+ *
+ * Workers are forked from the parent, so a graph built before creating the pool is shared by all of them: the
+ * kernel maps the same physical pages into each worker and only copies a page when it is written. Searches
+ * write to their own workspace and flows, never to the topology, so each worker only pays for its search state
+ * and the total memory stays close to that of the parent.
+ *
+ * Requests and answers are strings, sent with their length over a socket pair per worker. A worker that
+ * crashes only loses its request, which is answered with an empty string.
+ *
+ * The pool must be created while the parent runs a single thread, as only the forking thread survives in the
+ * workers.
+ */
+class WorkerPool {
+    public:
+        /** @brief Answers a request, in a worker */
+        using Handler = std::function<std::string(const std::string &request)>;
+
+    private:
+        struct Worker {
+            pid_t pid;
+            int socket;
+        };
+
+        std::vector<Worker> workers;
+
+        /**
+         * @brief Answers requests until the parent closes the socket, then exits the worker
+         *
+         * @param socket The worker's end of its socket pair
+         * @param handler Answers each request
+         */
+        [[noreturn]] static void serve(int socket, const Handler &handler);
+
+        /** @brief Stops a worker and waits for it to exit */
+        void stop(Worker &worker);
+
+    public:
+        /**
+         * @brief Forks the workers
+         *
+         * @param count The number of workers
+         * @param handler Answers each request, run in the workers with whatever it captured at the time of the fork
+         * @throws std::system_error if a worker can't be created
+         */
+        WorkerPool(unsigned count, Handler handler);
+
+        /** @brief Stops every worker */
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        /**
+         * @brief Answers every request, keeping each worker busy with one request at a time
+         *
+         * @param requests The requests
+         * @return The answers, in the order of the requests
+         */
+        std::vector<std::string> run(const std::vector<std::string> &requests);
+
+        /** @brief Gets the process id of each worker */
+        std::vector<pid_t> get_pids() const;
+};
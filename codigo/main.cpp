@@ -1,19 +1,182 @@
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
 #include <string.h>
+#include <ctype.h>
 #include "entities/graph.h"
 #include "dataset.h"
 #include "ui.h"
+#include "trace.h"
+#include "huge_pages.h"
+#include "engines.h"
+#include "edge_stream.h"
+#include "result_writer.h"
 
 using namespace std;
 
+/**
+ * @brief Writes the trace and the latency histograms, if they were asked for
+ *
+ * @param trace_file Where to write the Chrome trace, empty for nowhere
+ * @param histograms Whether to print the latency histograms
+ */
+static void write_traces(const string &trace_file, bool histograms) {
+    if (!trace_file.empty()) {
+        ofstream out(trace_file);
+        write_chrome_trace(out);
+    }
+
+    if (histograms) {
+        write_latency_histograms(cerr);
+    }
+}
+
+/**
+ * @brief Answers scenarios 2.4 and 2.5 in one pass over an edge file, without loading the graph
+ *
+ * @param path The edge file
+ * @param start The starting point
+ * @param end The ending point
+ * @param format The format of the results
+ * @param output_file Where to write the results, empty for the standard output
+ * @return The exit status
+ */
+static int stream_scenarios(const string &path, unsigned long start, unsigned long end, OutputFormat format, const string &output_file) {
+    ofstream file;
+    if (!output_file.empty()) {
+        file.open(output_file);
+    }
+    ostream &out = output_file.empty() ? cout : file;
+
+    try {
+        ResultWriter writer(out, format);
+        writer.text("\n");
+        writer.begin_table("waiting_periods", { "node", "duration" }, "[ node: {} ] (duration: {})\n");
+
+        StreamedMeetup result = stream_earliest_meetup(path, start, end, [&](uint64_t node, uint64_t duration) {
+            writer.row({ node, duration });
+        });
+
+        writer.end_table();
+        writer.value("earliest_meetup", "\nEarliest time at which a group of people would meetup again: {}\n\n", result.earliest_meetup);
+        writer.finish();
+
+        cerr << "Read " << result.nodes << " nodes and " << result.edges << " edges, holding at most "
+             << result.peak_frontier << " nodes at once" << endl;
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
-    bool sort = argc < 2 || strcmp(argv[1], "--no-sort") != 0;
+    OutputFormat format = OutputFormat::TEXT;
+    string output_file;
+    NodeOrder order = NodeOrder::FILE;
+    StatsOutput stats = StatsOutput::NONE;
+    string trace_file;
+    bool histograms = false;
+    vector<pair<string, string>> named_datasets;
+    size_t memory_budget = 0;
+    string snapshot_dir;
+    bool compress = false;
+    string edge_file;
+    unsigned long from = 0, to = 0;
+    chrono::milliseconds query_timeout = chrono::milliseconds::zero();
+    bool explain = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-sort") == 0) {
+            // Flows are always sorted now, which only costs sorting the edges with flow, so there's no order left to skip
+        } else if (strcmp(argv[i], "--format=text") == 0) {
+            format = OutputFormat::TEXT;
+        } else if (strcmp(argv[i], "--format=csv") == 0) {
+            format = OutputFormat::CSV;
+        } else if (strcmp(argv[i], "--format=json") == 0) {
+            format = OutputFormat::JSON;
+        } else if (strncmp(argv[i], "--output=", 9) == 0 && argv[i][9] != '\0') {
+            output_file = argv[i] + 9;
+        } else if (strcmp(argv[i], "--order=file") == 0 || strcmp(argv[i], "--order=bfs") == 0
+                   || strcmp(argv[i], "--order=topological") == 0 || strcmp(argv[i], "--order=rcm") == 0) {
+            order = parse_node_order(argv[i] + 8);
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            stats = StatsOutput::TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            stats = StatsOutput::JSON;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0 && argv[i][8] != '\0') {
+            trace_file = argv[i] + 8;
+        } else if (strcmp(argv[i], "--histograms") == 0) {
+            histograms = true;
+        } else if (strncmp(argv[i], "--dataset=", 10) == 0 && strchr(argv[i] + 10, '=') > argv[i] + 10) {
+            const char *separator = strchr(argv[i] + 10, '=');
+            named_datasets.push_back({ string(argv[i] + 10, separator - argv[i] - 10), separator + 1 });
+        } else if (strncmp(argv[i], "--memory-budget=", 16) == 0 && isdigit(argv[i][16])) {
+            memory_budget = stoul(argv[i] + 16) << 20;
+        } else if (strncmp(argv[i], "--snapshot-dir=", 15) == 0 && argv[i][15] != '\0') {
+            snapshot_dir = argv[i] + 15;
+        } else if (strcmp(argv[i], "--huge-pages=off") == 0 || strcmp(argv[i], "--huge-pages=transparent") == 0
+                   || strcmp(argv[i], "--huge-pages=explicit") == 0) {
+            set_huge_pages(parse_huge_pages(argv[i] + 13));
+        } else if (strcmp(argv[i], "--compress-adjacency") == 0) {
+            compress = true;
+        } else if (strncmp(argv[i], "--query-timeout=", 16) == 0 && isdigit(argv[i][16])) {
+            query_timeout = chrono::milliseconds(stoul(argv[i] + 16));
+        } else if (strcmp(argv[i], "--explain") == 0) {
+            explain = true;
+        } else if (strcmp(argv[i], "--widest-engine=auto") == 0 || strcmp(argv[i], "--widest-engine=heap") == 0
+                   || strcmp(argv[i], "--widest-engine=buckets") == 0 || strcmp(argv[i], "--widest-engine=dag") == 0) {
+            set_widest_path_engine(parse_widest_path_engine(argv[i] + 16));
+        } else if (strcmp(argv[i], "--flow-engine=auto") == 0 || strcmp(argv[i], "--flow-engine=edmonds-karp") == 0
+                   || strcmp(argv[i], "--flow-engine=blocking") == 0 || strcmp(argv[i], "--flow-engine=scaling") == 0) {
+            set_flow_engine(parse_flow_engine(argv[i] + 14));
+        } else if (strncmp(argv[i], "--edge-file=", 12) == 0 && argv[i][12] != '\0') {
+            edge_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--from=", 7) == 0 && isdigit(argv[i][7])) {
+            from = stoul(argv[i] + 7);
+        } else if (strncmp(argv[i], "--to=", 5) == 0 && isdigit(argv[i][5])) {
+            to = stoul(argv[i] + 5);
+        } else {
+            cerr << "usage: travel [--format=text|csv|json] [--output=file] [--order=file|bfs|topological|rcm]\n"
+             << "              [--stats[=text|json]] [--trace=file] [--histograms]\n"
+             << "              [--dataset=name=file]... [--memory-budget=MiB] [--snapshot-dir=dir]\n"
+             << "              [--huge-pages=off|transparent|explicit] [--compress-adjacency] [--query-timeout=ms]\n"
+             << "              [--explain] [--widest-engine=auto|heap|buckets|dag]\n"
+             << "              [--flow-engine=auto|edmonds-karp|blocking|scaling]\n"
+             << "       travel --edge-file=file --from=node --to=node [--format=...] [--output=file]" << endl;
+            return 1;
+        }
+    }
+
+    if (!edge_file.empty() || from != 0 || to != 0) {
+        if (edge_file.empty() || from == 0 || to == 0) {
+            cerr << "--edge-file, --from and --to go together" << endl;
+            return 1;
+        }
+
+        set_tracing(!trace_file.empty() || histograms);
+        int status = stream_scenarios(edge_file, from, to, format, output_file);
+        write_traces(trace_file, histograms);
+        return status;
+    }
+
+    if ((stats != StatsOutput::NONE || !trace_file.empty() || histograms) && !stats_enabled()) {
+        cerr << "travel was built without TRAVEL_STATS, so --stats, --trace and --histograms only report zeros" << endl;
+    }
+
+    set_tracing(!trace_file.empty() || histograms);
 
     try {
-        UI ui(sort);
+        UI ui(format, stats, output_file, order, named_datasets, memory_budget, snapshot_dir, compress, query_timeout, explain);
         ui.start();
-    } catch (exception ignored) {
+    } catch (const exception &) {
+        write_traces(trace_file, histograms);
         return 1;
     }
- 
+
+    write_traces(trace_file, histograms);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,63 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+using namespace std;
+
+static atomic<uint64_t> allocation_count{0};
+static atomic<uint64_t> allocation_bytes{0};
+
+/**
+ * @brief Allocates memory and counts the allocation
+ *
+ * @param size The number of bytes
+ * @return The memory, nullptr if it couldn't be allocated
+ */
+static void *counted_malloc(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocation_bytes.fetch_add(size, memory_order_relaxed);
+
+    return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new(size_t size) {
+    void *ptr = counted_malloc(size);
+    if (ptr == nullptr) {
+        throw bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept {
+    return counted_malloc(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+    return counted_malloc(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+AllocationStats allocation_stats() {
+    return { allocation_count.load(memory_order_relaxed), allocation_bytes.load(memory_order_relaxed) };
+}
@@ -0,0 +1,74 @@
+#include <csignal>
+
+#include "cancellation.h"
+
+using namespace std;
+
+CancellationToken::CancellationToken(chrono::steady_clock::duration timeout)
+    : state(make_shared<State>()), timeout(timeout) {}
+
+void CancellationToken::cancel() const {
+    state->cancelled = true;
+}
+
+bool CancellationToken::is_cancelled() const {
+    return state->cancelled;
+}
+
+bool CancellationToken::poll() const {
+    if (state->cancelled) {
+        return true;
+    }
+
+    if (timeout == chrono::steady_clock::duration::zero()) {
+        state->started = true;
+        return false;
+    }
+
+    // The first poll sets the deadline, which stays 0 until then; polls racing it read the one that won
+    auto now = chrono::steady_clock::now().time_since_epoch().count();
+    auto deadline = state->deadline.load();
+    if (deadline == 0 && state->deadline.compare_exchange_strong(deadline, now + timeout.count())) {
+        state->started = true;
+        return false;
+    }
+
+    // Running out of time cancels the token, so that later polls don't read the clock
+    if (now >= deadline) {
+        state->cancelled = true;
+        return true;
+    }
+
+    return false;
+}
+
+/** @brief The state of the token Ctrl-C cancels, only touched through lock-free atomics so that the handler can */
+static atomic<void *> interrupted_state{ nullptr };
+static struct sigaction previous_action;
+
+void CancelOnInterrupt::on_interrupt(int signal) {
+    auto *state = static_cast<CancellationToken::State *>(interrupted_state.load());
+
+    if (state && state->started) {
+        state->cancelled = true;
+        return;
+    }
+
+    sigaction(SIGINT, &previous_action, nullptr);
+    raise(signal);
+}
+
+CancelOnInterrupt::CancelOnInterrupt(const CancellationToken &token) {
+    interrupted_state = token.state.get();
+
+    struct sigaction action = {};
+    action.sa_handler = on_interrupt;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, &previous_action);
+}
+
+CancelOnInterrupt::~CancelOnInterrupt() {
+    sigaction(SIGINT, &previous_action, nullptr);
+    interrupted_state = nullptr;
+}
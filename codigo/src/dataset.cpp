@@ -3,10 +3,13 @@
 #include <sstream>
 
 #include "dataset.h"
+#include "trace.h"
 
 using namespace std;
 
 File::File(string path, char delim){
+    TRACE_SPAN("parse");
+
     ifstream file(path);
 
     if (!file.is_open())  {
@@ -27,7 +30,7 @@ bool File::read_header(ifstream &file, char delim) {
 
     istringstream stream(line);
     while(getline(stream, line, delim))  {
-        header.push_back(stoi(line));
+        header.push_back(stoul(line));
     }
 
     return true;
@@ -42,7 +45,7 @@ bool File::read_body(ifstream &file, char delim) {
         
         istringstream body(line);
         while(getline(body, data, delim))  {
-            entry.push_back(stoi(data));
+            entry.push_back(stoul(data));
         }
 
         entries.push_back(entry);
@@ -0,0 +1,186 @@
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "dataset_registry.h"
+#include "dataset.h"
+#include "snapshot.h"
+#include "trace.h"
+
+using namespace std;
+
+DatasetRegistry::DatasetRegistry(NodeOrder order, size_t budget, const string &snapshot_dir, bool compress)
+    : order(order), budget(budget), snapshot_dir(snapshot_dir), compress(compress) {}
+
+void DatasetRegistry::add(const string &name, const string &path) {
+    lock_guard<mutex> lock(entries_mutex);
+
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        if (it->second.path == path) {
+            return;
+        }
+
+        if (it->second.graph) {
+            recency.erase(it->second.position);
+            resident_bytes -= it->second.bytes;
+        }
+
+        entries.erase(it);
+    }
+
+    entries[name].path = path;
+}
+
+bool DatasetRegistry::contains(const string &name) const {
+    lock_guard<mutex> lock(entries_mutex);
+    return entries.count(name) > 0;
+}
+
+string DatasetRegistry::snapshot_path(const string &path) const {
+    if (snapshot_dir.empty()) {
+        return "";
+    }
+
+    error_code error;
+    filesystem::path source = filesystem::weakly_canonical(path, error);
+    if (error) {
+        source = filesystem::absolute(path);
+    }
+
+    // The file name keeps the cache readable, and the hash of the whole path tells apart files with the same name
+    ostringstream file;
+    file << source.filename().string() << '-' << hex << setw(16) << setfill('0') << hash<string>()(source.string()) << ".snap";
+
+    return (filesystem::path(snapshot_dir) / file.str()).string();
+}
+
+AnyGraph DatasetRegistry::read(const string &path) const {
+    SnapshotInfo info;
+    if (read_snapshot_info(path, info)) {
+        return load_snapshot(path);
+    }
+
+    string cached = snapshot_path(path);
+    error_code error;
+
+    if (!cached.empty() && read_snapshot_info(cached, info) && info.order == order
+        && filesystem::last_write_time(cached, error) >= filesystem::last_write_time(path, error) && !error) {
+        return load_snapshot(cached);
+    }
+
+    File file(path);
+    AnyGraph graph = load_graph(file, order);
+
+    if (!cached.empty()) {
+        // A cache that can't be written only costs the next load its speed
+        try {
+            filesystem::create_directories(snapshot_dir);
+            save_snapshot(graph, cached);
+        } catch (exception &) {}
+    }
+
+    return graph;
+}
+
+AnyGraph DatasetRegistry::load(const string &path) const {
+    AnyGraph graph = read(path);
+    if (compress) {
+        visit([](auto &graph) { graph.compress_adjacency(); }, graph);
+    }
+
+    return graph;
+}
+
+AnyGraph DatasetRegistry::get(const string &name) {
+    unique_lock<mutex> lock(entries_mutex);
+
+    Entry &entry = entries.at(name);
+    if (entry.graph) {
+        recency.splice(recency.begin(), recency, entry.position);
+        return *entry.graph;
+    }
+
+    // Someone else is loading it already
+    if (entry.loading.valid()) {
+        shared_future<shared_ptr<const AnyGraph>> loading = entry.loading;
+        lock.unlock();
+
+        return *loading.get();
+    }
+
+    string path = entry.path;
+    promise<shared_ptr<const AnyGraph>> loaded;
+    entry.loading = loaded.get_future().share();
+    lock.unlock();
+
+    shared_ptr<const AnyGraph> graph;
+    try {
+        graph = make_shared<const AnyGraph>(load(path));
+    } catch (...) {
+        loaded.set_exception(current_exception());
+
+        lock.lock();
+        auto it = entries.find(name);
+        if (it != entries.end() && it->second.path == path) {
+            it->second.loading = {};
+        }
+        throw;
+    }
+
+    size_t bytes = visit([](const auto &graph) { return graph.memory_usage(); }, *graph);
+
+    lock.lock();
+
+    // The name may have been registered again with another file meanwhile, in which case the graph is only
+    // handed to the callers that asked for it
+    auto it = entries.find(name);
+    if (it != entries.end() && it->second.path == path && !it->second.graph) {
+        Entry &published = it->second;
+        published.graph = graph;
+        published.loading = {};
+        published.bytes = bytes;
+        published.loads++;
+
+        recency.push_front(name);
+        published.position = recency.begin();
+        resident_bytes += bytes;
+
+        evict(name);
+    }
+
+    loaded.set_value(graph);
+    return *graph;
+}
+
+void DatasetRegistry::evict(const string &keep) {
+    while (budget > 0 && resident_bytes > budget && recency.back() != keep) {
+        Entry &entry = entries.at(recency.back());
+
+        resident_bytes -= entry.bytes;
+        entry.graph.reset();
+        entry.bytes = 0;
+        recency.pop_back();
+    }
+}
+
+vector<DatasetInfo> DatasetRegistry::list() const {
+    lock_guard<mutex> lock(entries_mutex);
+
+    vector<DatasetInfo> datasets;
+    for (const auto &[name, entry] : entries) {
+        datasets.push_back({ name, entry.path, entry.graph != nullptr, entry.bytes, entry.loads });
+    }
+
+    return datasets;
+}
+
+size_t DatasetRegistry::get_resident_bytes() const {
+    lock_guard<mutex> lock(entries_mutex);
+    return resident_bytes;
+}
+
+size_t DatasetRegistry::get_budget() const {
+    return budget;
+}
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+
+#include "edge_stream.h"
+#include "stats.h"
+#include "trace.h"
+
+using namespace std;
+
+/** @brief Marks an edge file, the last byte being the version of the format */
+static const char EDGE_STREAM_MAGIC[8] = { 'T', 'R', 'A', 'V', 'E', 'D', 'G', 1 };
+
+/**
+ * @brief The fixed start of an edge file
+ *
+ * It's followed by records of three values: a node starts its block as { 0, node, 0 }, and each edge of the block
+ * is { destination, duration, flow }. As no node is 0, the first value tells them apart.
+ */
+struct EdgeStreamHeader {
+    char magic[8];
+
+    /** @brief The size of each value, which also tells apart a file written in another byte order */
+    uint32_t value_bytes;
+    uint32_t flows;
+
+    uint64_t nodes;
+    uint64_t edges;
+};
+
+EdgeStreamWriter::EdgeStreamWriter(const string &path, bool wide, bool flows)
+    : path(path), buffer(EDGE_STREAM_BUFFER), wide(wide), flows(flows) {
+    file = fopen((path + ".partial").c_str(), "wb");
+    if (!file) {
+        throw runtime_error("Couldn't write " + path + ".partial");
+    }
+
+    write_header();
+}
+
+EdgeStreamWriter::~EdgeStreamWriter() {
+    if (file) {
+        fclose(file);
+        remove((path + ".partial").c_str());
+    }
+}
+
+void EdgeStreamWriter::write_header() {
+    EdgeStreamHeader header;
+    memcpy(header.magic, EDGE_STREAM_MAGIC, sizeof(EDGE_STREAM_MAGIC));
+    header.value_bytes = wide ? 8 : 4;
+    header.flows = flows;
+    header.nodes = nodes;
+    header.edges = edges;
+
+    fwrite(&header, sizeof(header), 1, file);
+}
+
+void EdgeStreamWriter::flush() {
+    fwrite(buffer.data(), 1, used, file);
+    used = 0;
+}
+
+void EdgeStreamWriter::put(uint64_t a, uint64_t b, uint64_t c) {
+    if (!wide && max({ a, b, c }) > numeric_limits<uint32_t>::max()) {
+        throw out_of_range("Value too big for an edge file of 32 bit values");
+    }
+
+    if (buffer.size() - used < 3 * sizeof(uint64_t)) {
+        flush();
+    }
+
+    for (uint64_t value : { a, b, c }) {
+        if (wide) {
+            memcpy(buffer.data() + used, &value, sizeof(uint64_t));
+            used += sizeof(uint64_t);
+        } else {
+            uint32_t narrow = value;
+            memcpy(buffer.data() + used, &narrow, sizeof(uint32_t));
+            used += sizeof(uint32_t);
+        }
+    }
+}
+
+void EdgeStreamWriter::add_node(uint64_t node) {
+    if (node == 0) {
+        throw out_of_range("Node 0 can't be in an edge file");
+    }
+
+    put(0, node, 0);
+    nodes++;
+}
+
+void EdgeStreamWriter::add_edge(uint64_t destination, uint64_t duration, uint64_t flow) {
+    if (nodes == 0) {
+        throw logic_error("Edge added to an edge file before any node");
+    }
+    if (destination == 0) {
+        throw out_of_range("Node 0 can't be in an edge file");
+    }
+
+    put(destination, duration, flows ? flow : 0);
+    edges++;
+}
+
+void EdgeStreamWriter::close() {
+    flush();
+
+    // The counts are only known now, so the header is written again over the first one
+    rewind(file);
+    write_header();
+
+    bool failed = ferror(file);
+    failed |= fclose(file) != 0;
+    file = nullptr;
+
+    if (failed) {
+        remove((path + ".partial").c_str());
+        throw runtime_error("Couldn't write " + path + ".partial");
+    }
+
+    filesystem::rename(path + ".partial", path);
+}
+
+/**
+ * @brief Writes a graph as an edge file, the nodes in the order of Kahn's algorithm
+ */
+template <class Index, class Weight>
+static void write_graph(const BasicGraph<Index, Weight> &graph, const string &path, bool flows) {
+    Index n = graph.size();
+    Index m = graph.edge_count();
+
+    vector<Index> in_degree(n + 1, 0);
+    for (Index e = 0; e < m; e++) {
+        in_degree[graph.get_edge(e).get_destination()]++;
+    }
+
+    vector<Index> order;
+    order.reserve(n);
+    for (Index i = 1; i <= n; i++) {
+        if (in_degree[i] == 0) {
+            order.push_back(i);
+        }
+    }
+
+    EdgeStreamWriter writer(path, sizeof(Index) == 8, flows);
+
+    for (size_t head = 0; head < order.size(); head++) {
+        Index node = order[head];
+        writer.add_node(graph.to_external_id(node));
+
+        for (Index e : graph.get_adjacency(node).outgoing) {
+            auto edge = graph.get_edge(e);
+            writer.add_edge(graph.to_external_id(edge.get_destination()), edge.get_duration(), graph.get_flow(e));
+
+            if (--in_degree[edge.get_destination()] == 0) {
+                order.push_back(edge.get_destination());
+            }
+        }
+    }
+
+    if (order.size() < n) {
+        throw invalid_argument("Only a graph without cycles can be written as an edge file");
+    }
+
+    writer.close();
+}
+
+void write_edge_stream(const AnyGraph &graph, const string &path, bool flows) {
+    TRACE_SPAN("write edge file");
+    visit([&](const auto &graph) { write_graph(graph, path, flows); }, graph);
+}
+
+/**
+ * @brief Reads and checks the header of an edge file
+ *
+ * @return false if the file doesn't start with an edge file written on this machine
+ */
+static bool read_header(FILE *file, EdgeStreamHeader &header) {
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        return false;
+    }
+
+    return memcmp(header.magic, EDGE_STREAM_MAGIC, sizeof(EDGE_STREAM_MAGIC)) == 0
+        && (header.value_bytes == 4 || header.value_bytes == 8);
+}
+
+bool read_edge_stream_info(const string &path, EdgeStreamInfo &info) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    EdgeStreamHeader header;
+    bool valid = read_header(file, header);
+    fclose(file);
+
+    if (valid) {
+        info = { header.value_bytes == 8, header.flows != 0, header.nodes, header.edges };
+    }
+    return valid;
+}
+
+/**
+ * @brief Reads the rest of a file sequentially on a thread of its own, a few chunks ahead of the caller
+ *
+ * Chunks cycle through a fixed set of buffers, so memory stays the same however big the file is: the thread
+ * waits once every buffer holds a chunk the caller hasn't finished with, and the caller only waits when it's
+ * faster than the disk.
+ */
+class ReadAhead {
+    FILE *file;
+
+    vector<vector<char>> buffers;
+    vector<size_t> sizes;
+
+    mutex lock;
+    condition_variable changed;
+
+    /** @brief The chunks read, handed to the caller and given back by it */
+    size_t read = 0;
+    size_t handed = 0;
+    size_t released = 0;
+
+    bool finished = false;
+    bool failed = false;
+    bool stopping = false;
+
+    thread reader;
+
+    void run() {
+        for (size_t chunk = 0;; chunk++) {
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&] { return stopping || chunk - released < buffers.size(); });
+                if (stopping) {
+                    return;
+                }
+            }
+
+            vector<char> &buffer = buffers[chunk % buffers.size()];
+            size_t size = fread(buffer.data(), 1, buffer.size(), file);
+            bool error = ferror(file);
+
+            {
+                lock_guard<mutex> guard(lock);
+                sizes[chunk % buffers.size()] = size;
+                read = chunk + 1;
+                failed = error;
+                finished = error || size < buffer.size();
+            }
+            changed.notify_all();
+
+            if (error || size < buffer.size()) {
+                return;
+            }
+        }
+    }
+
+    public:
+        /**
+         * @brief Starts reading a file from where it's positioned
+         *
+         * @param file The file, which must stay open until this is destroyed
+         * @param chunk_bytes The size of each chunk
+         * @param count The number of buffers
+         */
+        ReadAhead(FILE *file, size_t chunk_bytes, size_t count)
+            : file(file), buffers(count, vector<char>(chunk_bytes)), sizes(count, 0) {
+#ifdef POSIX_FADV_SEQUENTIAL
+            posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            // The chunks are already big, stdio's own buffer would only add a copy
+            setvbuf(file, nullptr, _IONBF, 0);
+
+            reader = thread(&ReadAhead::run, this);
+        }
+
+        ~ReadAhead() {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            changed.notify_all();
+            reader.join();
+        }
+
+        /**
+         * @brief Waits for the next chunk, giving back the previous one
+         *
+         * @return The chunk, which stays valid until the next call, and its size, 0 at the end of the file
+         * @throws std::runtime_error if the file couldn't be read
+         */
+        pair<const char *, size_t> next() {
+            unique_lock<mutex> guard(lock);
+            released = handed;
+            changed.notify_all();
+
+            changed.wait(guard, [&] { return read > handed || finished; });
+            if (failed) {
+                throw runtime_error("Couldn't read the edge file");
+            }
+            if (read == handed) {
+                return { nullptr, 0 };
+            }
+
+            size_t slot = handed++ % buffers.size();
+            return { buffers[slot].data(), sizes[slot] };
+        }
+};
+
+/**
+ * @brief Runs the pass of stream_earliest_meetup over the records of a file with values of the given type
+ */
+template <class Value>
+static StreamedMeetup stream_pass(ReadAhead &input, const EdgeStreamHeader &header, Value start, Value end,
+                                  const function<void(uint64_t, uint64_t)> &on_wait) {
+    /** @brief A node reached but not read yet, with the latest and the earliest arrival so far */
+    struct Reached {
+        Value earliest_start;
+        Value earliest_arrival;
+    };
+
+    const size_t record = 3 * sizeof(Value);
+
+    unordered_map<Value, Reached> frontier;
+    frontier[start] = { 0, 0 };
+
+    StreamedMeetup result = { false, 0, 0, 0, 1 };
+
+    // The node whose block is being read, and its entry if it was reached; entries don't move when the map grows
+    Value node = 0;
+    Reached *current = nullptr;
+
+    // Every edge entering the node was read before its block, so it's settled once the block ends
+    auto settle = [&]() {
+        if (!current) {
+            return;
+        }
+
+        if (current->earliest_arrival < current->earliest_start && on_wait) {
+            on_wait(node, current->earliest_start - current->earliest_arrival);
+        }
+        if (node == end) {
+            result.reached = true;
+            result.earliest_meetup = current->earliest_start;
+        }
+
+        frontier.erase(node);
+        current = nullptr;
+    };
+
+    for (auto [data, size] = input.next(); size > 0; tie(data, size) = input.next()) {
+        if (size % record != 0) {
+            throw invalid_argument("Truncated edge file");
+        }
+
+        for (const char *at = data; at < data + size; at += record) {
+            Value values[3];
+            memcpy(values, at, record);
+
+            if (values[0] == 0) {
+                settle();
+
+                node = values[1];
+                result.nodes++;
+
+                auto it = frontier.find(node);
+                current = it == frontier.end() ? nullptr : &it->second;
+                continue;
+            }
+
+            COUNT_STAT(edges_relaxed);
+            result.edges++;
+
+            if (!current || (header.flows && values[2] == 0)) {
+                continue;
+            }
+
+            Value arrival = current->earliest_start + values[1];
+            auto [it, inserted] = frontier.try_emplace(values[0], Reached{ arrival, arrival });
+            if (!inserted) {
+                it->second.earliest_start = max(it->second.earliest_start, arrival);
+                it->second.earliest_arrival = min(it->second.earliest_arrival, arrival);
+            } else if (frontier.size() > result.peak_frontier) {
+                result.peak_frontier = frontier.size();
+            }
+        }
+    }
+
+    settle();
+    return result;
+}
+
+StreamedMeetup stream_earliest_meetup(const string &path, uint64_t start, uint64_t end,
+                                      const function<void(uint64_t, uint64_t)> &on_wait, size_t buffer_bytes) {
+    TRACE_SPAN("stream");
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        throw invalid_argument("Couldn't open given file");
+    }
+
+    unique_ptr<FILE, int (*)(FILE *)> closer(file, fclose);
+
+    EdgeStreamHeader header;
+    if (!read_header(file, header)) {
+        throw invalid_argument("Not an edge file written on this machine");
+    }
+
+    // Whole records in each chunk, so that none is split between two of them
+    const size_t record = 3 * header.value_bytes;
+    ReadAhead input(file, max(buffer_bytes / record, size_t(1)) * record, 3);
+
+    if (header.value_bytes == 8) {
+        return stream_pass<uint64_t>(input, header, start, end, on_wait);
+    }
+
+    if (max(start, end) > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument("Node not in the edge file");
+    }
+    return stream_pass<uint32_t>(input, header, start, end, on_wait);
+}
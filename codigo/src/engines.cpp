@@ -0,0 +1,164 @@
+#include <ostream>
+#include <stdexcept>
+#include "engines.h"
+
+using namespace std;
+
+static WidestPathEngine forced_widest_path = WidestPathEngine::AUTO;
+static FlowEngine forced_flow = FlowEngine::AUTO;
+
+double GraphProfile::density() const {
+    return nodes == 0 ? 0 : double(edges) / nodes;
+}
+
+void GraphProfile::print(ostream &out) const {
+    if (!valid) {
+        out << "no profile, as edges were added after loading";
+        return;
+    }
+
+    out << nodes << " nodes, " << edges << " edges, " << density() << " edges per node, ";
+    if (acyclic) {
+        out << "acyclic with depth " << depth;
+    } else {
+        out << "cyclic";
+    }
+    out << ", capacities " << min_capacity << " to " << max_capacity;
+}
+
+WidestPathChoice choose_widest_path_engine(const GraphProfile &profile) {
+    bool buckets = profile.valid && profile.max_capacity <= BUCKET_QUEUE_LIMIT;
+
+    switch (forced_widest_path) {
+        case WidestPathEngine::HEAP:
+            return { WidestPathEngine::HEAP, "forced by --widest-engine" };
+        case WidestPathEngine::DAG_SWEEP:
+            if (profile.valid && profile.acyclic) {
+                return { WidestPathEngine::DAG_SWEEP, "forced by --widest-engine" };
+            }
+            return { WidestPathEngine::HEAP, "--widest-engine asked for a DAG sweep, but the graph isn't known to be acyclic" };
+        case WidestPathEngine::BUCKET_QUEUE:
+            if (buckets) {
+                return { WidestPathEngine::BUCKET_QUEUE, "forced by --widest-engine" };
+            }
+            return { WidestPathEngine::HEAP, "--widest-engine asked for buckets, but capacities span too many values" };
+        case WidestPathEngine::AUTO:
+            break;
+    }
+
+    if (!profile.valid) {
+        return { WidestPathEngine::HEAP, "the graph changed since it was profiled" };
+    }
+    if (profile.acyclic) {
+        return { WidestPathEngine::DAG_SWEEP, "the graph is acyclic, so each node is final once the nodes before it in topological order are" };
+    }
+    if (buckets && profile.max_capacity <= profile.edges) {
+        return { WidestPathEngine::BUCKET_QUEUE, "capacities span few values, so a bucket per value replaces the heap" };
+    }
+
+    return { WidestPathEngine::HEAP, "the graph has cycles and capacities span too many values for buckets" };
+}
+
+FlowChoice choose_flow_engine(const GraphProfile &profile, bool bounded, bool routed) {
+    if (bounded) {
+        return { FlowEngine::EDMONDS_KARP, "a group of a given size is routed a path at a time, stopping once it fits" };
+    }
+
+    switch (forced_flow) {
+        case FlowEngine::EDMONDS_KARP:
+            return { FlowEngine::EDMONDS_KARP, "forced by --flow-engine" };
+        case FlowEngine::BLOCKING_FLOW:
+            return { FlowEngine::BLOCKING_FLOW, "forced by --flow-engine" };
+        case FlowEngine::CAPACITY_SCALING:
+            if (profile.valid) {
+                return { FlowEngine::CAPACITY_SCALING, "forced by --flow-engine" };
+            }
+            return { FlowEngine::BLOCKING_FLOW, "--flow-engine asked for capacity scaling, but the capacity range isn't known" };
+        case FlowEngine::AUTO:
+            break;
+    }
+
+    if (routed) {
+        return { FlowEngine::EDMONDS_KARP, "the route is shown and followed by the meetup and waiting periods, which Edmonds-Karp keeps as before" };
+    }
+
+    // Capacity scaling was slower than plain blocking flow on every graph measured, however wide its capacities,
+    // and blocking flow needs no profile, so it's the default
+    return { FlowEngine::BLOCKING_FLOW, "one BFS per phase saturates every shortest path, where Edmonds-Karp takes one" };
+}
+
+void set_widest_path_engine(WidestPathEngine engine) {
+    forced_widest_path = engine;
+}
+
+WidestPathEngine get_widest_path_engine() {
+    return forced_widest_path;
+}
+
+void set_flow_engine(FlowEngine engine) {
+    forced_flow = engine;
+}
+
+FlowEngine get_flow_engine() {
+    return forced_flow;
+}
+
+WidestPathEngine parse_widest_path_engine(const string &name) {
+    if (name == "auto") return WidestPathEngine::AUTO;
+    if (name == "heap") return WidestPathEngine::HEAP;
+    if (name == "buckets") return WidestPathEngine::BUCKET_QUEUE;
+    if (name == "dag") return WidestPathEngine::DAG_SWEEP;
+
+    throw invalid_argument("Unknown widest path engine " + name + ", expected auto, heap, buckets or dag");
+}
+
+FlowEngine parse_flow_engine(const string &name) {
+    if (name == "auto") return FlowEngine::AUTO;
+    if (name == "edmonds-karp") return FlowEngine::EDMONDS_KARP;
+    if (name == "blocking") return FlowEngine::BLOCKING_FLOW;
+    if (name == "scaling") return FlowEngine::CAPACITY_SCALING;
+
+    throw invalid_argument("Unknown flow engine " + name + ", expected auto, edmonds-karp, blocking or scaling");
+}
+
+const char *engine_name(WidestPathEngine engine) {
+    switch (engine) {
+        case WidestPathEngine::HEAP: return "heap";
+        case WidestPathEngine::BUCKET_QUEUE: return "buckets";
+        case WidestPathEngine::DAG_SWEEP: return "dag";
+        default: return "auto";
+    }
+}
+
+const char *engine_name(FlowEngine engine) {
+    switch (engine) {
+        case FlowEngine::EDMONDS_KARP: return "edmonds-karp";
+        case FlowEngine::BLOCKING_FLOW: return "blocking";
+        case FlowEngine::CAPACITY_SCALING: return "scaling";
+        default: return "auto";
+    }
+}
+
+void EngineReport::print(ostream &out) const {
+    if (!widest_path_used && !flow_used) {
+        out << "Engines: this scenario has a single algorithm\n";
+        return;
+    }
+
+    if (widest_path_used) {
+        out << "Widest path engine: " << engine_name(widest_path.engine) << ", as " << widest_path.reason
+            << ", took " << widest_path_milliseconds << " ms\n";
+    }
+    if (flow_used) {
+        out << "Maximum flow engine: " << engine_name(flow.engine) << ", as " << flow.reason
+            << ", took " << flow_milliseconds << " ms\n";
+    }
+
+    out << "Graph: ";
+    profile.print(out);
+    out << "\n";
+}
+
+void start_engine_report() {
+    engine_report() = EngineReport();
+}
@@ -1,32 +1,47 @@
+#include <chrono>
 #include <queue>
 #include <set>
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <istream>
+#include <ostream>
 #include "entities/graph.h"
 #include "max_heap.h"
+#include "stats.h"
+#include "trace.h"
 
 using namespace std;
 
-Edge::Edge(unsigned long origin, unsigned long destination, unsigned long capacity, unsigned long duration): flow(0) {
+template <class Index, class Weight>
+BasicEdge<Index, Weight>::BasicEdge(Index origin, Index destination, Weight capacity, Weight duration, Weight departure) {
     this->origin = origin;
     this->destination = destination;
     this->capacity = capacity;
     this->duration = duration;
+    this->departure = departure;
 }
 
-Edge::Edge(const Edge &edge) : Edge(edge.get_origin(), edge.get_destination(), edge.get_capacity(), edge.get_duration()) {};
+template <class Index, class Weight>
+BasicEdge<Index, Weight>::BasicEdge(const BasicEdge &edge) : BasicEdge(edge.get_origin(), edge.get_destination(), edge.get_capacity(), edge.get_duration(), edge.get_departure()) {
+    this->active = edge.active;
+};
 
 
-Edge Edge::from_entry(const FileEntry &entry) {
-    unsigned long origin = entry.at(0);
-    unsigned long destination = entry.at(1);
-    unsigned long capacity = entry.at(2);
-    unsigned long duration = entry.at(3);
+template <class Index, class Weight>
+BasicEdge<Index, Weight> BasicEdge<Index, Weight>::from_entry(const FileEntry &entry) {
+    Index origin = entry.at(0);
+    Index destination = entry.at(1);
+    Weight capacity = entry.at(2);
+    Weight duration = entry.at(3);
+    Weight departure = entry.size() > 4 ? entry[4] : 0;
 
-    return Edge{origin, destination, capacity, duration};
+    return BasicEdge{origin, destination, capacity, duration, departure};
 }
 
-vector<Edge> Edge::from_file(const File &file) {
-    vector<Edge> edges;
+template <class Index, class Weight>
+vector<BasicEdge<Index, Weight>> BasicEdge<Index, Weight>::from_file(const File &file) {
+    vector<BasicEdge> edges;
 
     for (const FileEntry &entry : file.get_entries()) {
         edges.push_back(from_entry(entry));
@@ -35,77 +50,626 @@ vector<Edge> Edge::from_file(const File &file) {
     return edges;
 }
 
-unsigned long Edge::get_origin() const {
+template <class Index, class Weight>
+Index BasicEdge<Index, Weight>::get_origin() const {
     return origin;
 }
 
-unsigned long Edge::get_destination() const {
+template <class Index, class Weight>
+Index BasicEdge<Index, Weight>::get_destination() const {
     return destination;
 }
 
-unsigned long Edge::get_capacity() const {
+template <class Index, class Weight>
+Weight BasicEdge<Index, Weight>::get_capacity() const {
     return capacity;
 }
 
-unsigned long Edge::get_duration() const {
+template <class Index, class Weight>
+Weight BasicEdge<Index, Weight>::get_duration() const {
     return duration;
 }
 
+template <class Index, class Weight>
+Weight BasicEdge<Index, Weight>::get_departure() const {
+    return departure;
+}
+
+template <class Index, class Weight>
+bool BasicEdge<Index, Weight>::is_active() const {
+    return active;
+}
+
+template <class Index, class Weight>
+void BasicEdge<Index, Weight>::set_active(bool active) {
+    this->active = active;
+}
+
+
+template <class Index, class Weight>
+void BasicEdgeTable<Index, Weight>::push_back(const Edge &edge) {
+    origins.push_back(edge.get_origin());
+    destinations.push_back(edge.get_destination());
+    capacities.push_back(edge.get_capacity());
+    durations.push_back(edge.get_duration());
+    departures.push_back(edge.get_departure());
+    active.push_back(edge.is_active());
+}
+
+template <class Index, class Weight>
+BasicEdge<Index, Weight> BasicEdgeTable<Index, Weight>::operator[](size_t e) const {
+    Edge edge(origins[e], destinations[e], capacities[e], durations[e], departures[e]);
+    edge.set_active(active[e]);
+
+    return edge;
+}
+
+template <class Index, class Weight>
+BasicEdge<Index, Weight> BasicEdgeTable<Index, Weight>::at(size_t e) const {
+    if (e >= size()) {
+        throw out_of_range("Invalid edge id");
+    }
+
+    return (*this)[e];
+}
+
+template <class Index, class Weight>
+void BasicEdgeTable<Index, Weight>::set_active(size_t e, bool active) {
+    this->active.at(e) = active;
+}
+
+/**
+ * @brief Writes a vector's elements as a raw array
+ */
+template <class T, class A>
+static void write_column(ostream &out, const vector<T, A> &column) {
+    out.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+}
+
+/**
+ * @brief Reads a raw array written by write_column
+ *
+ * @return false if the stream ended early
+ */
+template <class T, class A>
+static bool read_column(istream &in, vector<T, A> &column, size_t count) {
+    column.resize(count);
+    in.read(reinterpret_cast<char *>(column.data()), count * sizeof(T));
+
+    return (size_t) in.gcount() == count * sizeof(T);
+}
+
+template <class Index, class Weight>
+void BasicEdgeTable<Index, Weight>::write(ostream &out) const {
+    write_column(out, origins);
+    write_column(out, destinations);
+    write_column(out, capacities);
+    write_column(out, durations);
+    write_column(out, departures);
+    write_column(out, active);
+}
+
+template <class Index, class Weight>
+bool BasicEdgeTable<Index, Weight>::read(istream &in, size_t count) {
+    return read_column(in, origins, count) && read_column(in, destinations, count) && read_column(in, capacities, count)
+        && read_column(in, durations, count) && read_column(in, departures, count) && read_column(in, active, count);
+}
+
+template <class Index, class Weight>
+size_t BasicEdgeTable<Index, Weight>::memory_usage() const {
+    return (origins.capacity() + destinations.capacity()) * sizeof(Index)
+        + (capacities.capacity() + durations.capacity() + departures.capacity()) * sizeof(Weight) + active.capacity();
+}
+
+template <class Index, class Weight>
+size_t BasicEdgeTable<Index, Weight>::size() const {
+    return origins.size();
+}
+
+template <class Index, class Weight>
+typename BasicEdgeTable<Index, Weight>::const_iterator BasicEdgeTable<Index, Weight>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template <class Index, class Weight>
+typename BasicEdgeTable<Index, Weight>::const_iterator BasicEdgeTable<Index, Weight>::end() const {
+    return const_iterator(this, size());
+}
+
+template <class Index, class Weight>
+const HugeVector<Index> &BasicEdgeTable<Index, Weight>::get_origins() const {
+    return origins;
+}
+
+template <class Index, class Weight>
+const HugeVector<Index> &BasicEdgeTable<Index, Weight>::get_destinations() const {
+    return destinations;
+}
+
+template <class Index, class Weight>
+const HugeVector<Weight> &BasicEdgeTable<Index, Weight>::get_capacities() const {
+    return capacities;
+}
+
+template <class Index, class Weight>
+const HugeVector<Weight> &BasicEdgeTable<Index, Weight>::get_durations() const {
+    return durations;
+}
+
+template <class Index, class Weight>
+const HugeVector<Weight> &BasicEdgeTable<Index, Weight>::get_departures() const {
+    return departures;
+}
+
+template <class Index, class Weight>
+const HugeVector<uint8_t> &BasicEdgeTable<Index, Weight>::get_active() const {
+    return active;
+}
+
+/** @brief Appends a varint, 7 bits per byte from the lowest, the top bit set on every byte but the last */
+static void write_varint(HugeVector<uint8_t> &bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+
+    bytes.push_back((uint8_t) value);
+}
+
+/** @brief Appends the zigzag-encoded differences between consecutive ids of a list */
+template <class Index>
+static void write_list(HugeVector<uint8_t> &bytes, const vector<Index> &list) {
+    Index previous = 0;
+    for (Index id : list) {
+        // Ids are edge ids, so they are far below 2^63 even for 64-bit graphs
+        int64_t delta = (int64_t) id - (int64_t) previous;
+        write_varint(bytes, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+        previous = id;
+    }
+}
+
+template <class Index>
+void BasicCompressedAdjacency<Index>::build(const HugeVector<BasicAdjacency<Index>> &adjacency) {
+    bytes.clear();
+    offsets.clear();
+    offsets.reserve(adjacency.size() + 1);
+
+    HugeVector<uint8_t> outgoing;
+    for (const BasicAdjacency<Index> &lists : adjacency) {
+        offsets.push_back(bytes.size());
+
+        outgoing.clear();
+        write_list(outgoing, lists.outgoing);
+        write_varint(bytes, outgoing.size());
+        bytes.insert(bytes.end(), outgoing.begin(), outgoing.end());
+        write_list(bytes, lists.incoming);
+    }
+    offsets.push_back(bytes.size());
+
+    // Iterators decode one varint past the end of each list, which must stay within the array
+    bytes.resize(bytes.size() + 16, 0);
+    bytes.shrink_to_fit();
+}
+
+template <class Index>
+BasicAdjacency<Index> BasicCompressedAdjacency<Index>::decode(size_t node) const {
+    Lists lists = (*this)[node];
+
+    BasicAdjacency<Index> adjacency;
+    for (Index e : lists.outgoing) {
+        adjacency.outgoing.push_back(e);
+    }
+    for (Index e : lists.incoming) {
+        adjacency.incoming.push_back(e);
+    }
+
+    return adjacency;
+}
+
+template <class Index>
+bool BasicCompressedAdjacency<Index>::empty() const {
+    return offsets.empty();
+}
+
+template <class Index>
+size_t BasicCompressedAdjacency<Index>::memory_usage() const {
+    return bytes.capacity() + offsets.capacity() * sizeof(uint64_t);
+}
+
+
+template <class Index, class Weight>
+BasicGraph<Index, Weight>::BasicGraph() : topology(make_shared<Topology>()) {
+    topology->adjacency.resize(1);
+}
+
+template <class Index, class Weight>
+BasicGraph<Index, Weight>::BasicGraph(Index n) : n(n), topology(make_shared<Topology>()) {
+    topology->n = n;
+    topology->adjacency.resize(n + 1);
+}
+
+template <class Index, class Weight>
+BasicGraph<Index, Weight>::BasicGraph(const BasicGraph &g) : n(g.n), topology(g.topology), flows(g.flows), capacities(g.capacities) {}
+
+template <class Index, class Weight>
+BasicGraph<Index, Weight>::BasicGraph(shared_ptr<Topology> topology) : n(topology->n), topology(move(topology)) {
+    flows.resize(this->topology->edges.size());
+
+    if (!this->topology->profile.valid) {
+        update_profile();
+    }
+}
+
+template <class Index, class Weight>
+HugeVector<BasicNode<Index, Weight>> &BasicGraph<Index, Weight>::prepare_nodes() {
+    workspace.nodes.resize(n + 1);
+    return workspace.nodes;
+}
+
+template <class Index, class Weight>
+typename BasicGraph<Index, Weight>::Topology &BasicGraph<Index, Weight>::mutable_topology() {
+    if (topology.use_count() > 1) {
+        topology = make_shared<Topology>(*topology);
+    }
+
+    return *topology;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::update_profile() {
+    TRACE_SPAN("profile");
+
+    Topology &topology = *this->topology;
+    const HugeVector<Index> &destinations = topology.edges.get_destinations();
+    const HugeVector<Weight> &capacities = topology.edges.get_capacities();
+
+    GraphProfile &profile = topology.profile;
+    profile = GraphProfile();
+    profile.nodes = n;
+    profile.edges = topology.edges.size();
+
+    if (!capacities.empty()) {
+        auto [smallest, biggest] = minmax_element(capacities.begin(), capacities.end());
+        profile.min_capacity = *smallest;
+        profile.max_capacity = *biggest;
+    }
+
+    // Kahn's algorithm, which also gives the most edges on a path to each node. Both counts of a node are kept
+    // together, as edges reach them in no particular order
+    struct Counts {
+        Index in_degree;
+        Index depth;
+    };
+    vector<Counts> counts(n + 1, { 0, 0 });
+    for (Index destination : destinations) {
+        counts[destination].in_degree++;
+    }
+
+    HugeVector<Index> order;
+    order.reserve(n);
+    for (Index i = 1; i <= n; i++) {
+        if (counts[i].in_degree == 0) {
+            order.push_back(i);
+        }
+    }
+
+    Index depth = 0;
+    topology.visit_adjacency([&](const auto &adjacency) {
+        for (size_t head = 0; head < order.size(); head++) {
+            Index node = order[head];
+            Index next_depth = counts[node].depth + 1;
+
+            for (Index e : adjacency[node].outgoing) {
+                Counts &destination = counts[destinations[e]];
+                destination.depth = max(destination.depth, next_depth);
+
+                if (--destination.in_degree == 0) {
+                    order.push_back(destinations[e]);
+                    depth = max(depth, next_depth);
+                }
+            }
+        }
+    });
+
+    profile.acyclic = order.size() == n;
+    profile.valid = true;
+
+    // Nodes on a cycle never come out of the queue, so a partial order is no use to the sweep
+    if (!profile.acyclic) {
+        HugeVector<Index>().swap(topology.topological_order);
+        HugeVector<Index>().swap(topology.topological_position);
+        return;
+    }
+
+    profile.depth = depth;
+
+    topology.topological_position.assign(n + 1, 0);
+    for (Index i = 0; i < n; i++) {
+        topology.topological_position[order[i]] = i;
+    }
+    topology.topological_order = move(order);
+}
+
+/**
+ * @brief Numbers the nodes of a graph in an order that keeps neighbors close together
+ *
+ * @param n The number of nodes
+ * @param edges The edges, whose ends must all be between 1 and n
+ * @param order The order
+ * @return The node given each new id, from 1 to n, with 0 kept at 0
+ */
+template <class Index, class Weight>
+static vector<Index> renumbering(Index n, const vector<BasicEdge<Index, Weight>> &edges, NodeOrder order) {
+    // Neighbors of each node, in edge order: the successors only for a topological order, every neighbor otherwise
+    bool directed = order == NodeOrder::TOPOLOGICAL;
+    vector<Index> first(n + 2, 0), neighbors;
+    vector<Index> in_degree(n + 1, 0);
+
+    for (const auto &edge : edges) {
+        first[edge.get_origin() + 1]++;
+        if (!directed) first[edge.get_destination() + 1]++;
+        in_degree[edge.get_destination()]++;
+    }
+    for (Index i = 1; i <= n + 1; i++) {
+        first[i] += first[i - 1];
+    }
+
+    neighbors.resize(first[n + 1]);
+    vector<Index> fill = first;
+    for (const auto &edge : edges) {
+        neighbors[fill[edge.get_origin()]++] = edge.get_destination();
+        if (!directed) neighbors[fill[edge.get_destination()]++] = edge.get_origin();
+    }
+
+    vector<Index> order_of_nodes{ 0 };
+    vector<bool> placed(n + 1, false);
+    order_of_nodes.reserve(n + 1);
+
+    auto degree = [&](Index node) { return first[node + 1] - first[node]; };
+
+    // Breadth-first from a root, the neighbors of each node by increasing degree for RCM
+    auto visit_from = [&](Index root) {
+        size_t head = order_of_nodes.size();
+        order_of_nodes.push_back(root);
+        placed[root] = true;
+
+        for (; head < order_of_nodes.size(); head++) {
+            Index node = order_of_nodes[head];
+            size_t added = order_of_nodes.size();
+
+            for (Index i = first[node]; i < first[node + 1]; i++) {
+                if (!placed[neighbors[i]]) {
+                    placed[neighbors[i]] = true;
+                    order_of_nodes.push_back(neighbors[i]);
+                }
+            }
+
+            if (order == NodeOrder::RCM) {
+                stable_sort(order_of_nodes.begin() + added, order_of_nodes.end(), [&](Index a, Index b) {
+                    return degree(a) < degree(b);
+                });
+            }
+        }
+    };
+
+    if (order == NodeOrder::TOPOLOGICAL) {
+        // Kahn's algorithm; nodes on cycles, which datasets shouldn't have, go last in id order
+        for (Index i = 1; i <= n; i++) {
+            if (in_degree[i] == 0) {
+                order_of_nodes.push_back(i);
+                placed[i] = true;
+            }
+        }
+
+        for (size_t head = 1; head < order_of_nodes.size(); head++) {
+            Index node = order_of_nodes[head];
+            for (Index i = first[node]; i < first[node + 1]; i++) {
+                if (--in_degree[neighbors[i]] == 0) {
+                    placed[neighbors[i]] = true;
+                    order_of_nodes.push_back(neighbors[i]);
+                }
+            }
+        }
+    } else if (order == NodeOrder::BFS) {
+        visit_from(1);
+    } else if (order == NodeOrder::RCM) {
+        // Each component starts at one of its nodes of lowest degree
+        vector<Index> by_degree;
+        for (Index i = 1; i <= n; i++) {
+            by_degree.push_back(i);
+        }
+        stable_sort(by_degree.begin(), by_degree.end(), [&](Index a, Index b) {
+            return degree(a) < degree(b);
+        });
+
+        for (Index root : by_degree) {
+            if (!placed[root]) {
+                visit_from(root);
+            }
+        }
+
+        reverse(order_of_nodes.begin() + 1, order_of_nodes.end());
+    }
+
+    for (Index i = 1; i <= n; i++) {
+        if (!placed[i]) {
+            if (order == NodeOrder::BFS) {
+                visit_from(i);
+            } else {
+                order_of_nodes.push_back(i);
+            }
+        }
+    }
+
+    return order_of_nodes;
+}
+
+template <class Index, class Weight>
+BasicGraph<Index, Weight> BasicGraph<Index, Weight>::from_file(const File &file, NodeOrder order) {
+    BasicGraph graph(file.get_header().at(0));
+    vector<Edge> edges = Edge::from_file(file);
+
+    // Edges out of range are left for add_edge to reject
+    bool valid = all_of(edges.begin(), edges.end(), [&](const Edge &edge) {
+        return edge.get_origin() != 0 && edge.get_destination() != 0 && edge.get_origin() <= graph.n && edge.get_destination() <= graph.n;
+    });
+
+    if (order != NodeOrder::FILE && valid) {
+        Topology &topology = *graph.topology;
+        topology.order = order;
+
+        topology.to_external = renumbering(graph.n, edges, order);
+        topology.to_internal.resize(graph.n + 1);
+        for (Index i = 0; i <= graph.n; i++) {
+            topology.to_internal[topology.to_external[i]] = i;
+        }
+
+        for (Edge &edge : edges) {
+            edge = Edge(topology.to_internal[edge.get_origin()], topology.to_internal[edge.get_destination()],
+                        edge.get_capacity(), edge.get_duration(), edge.get_departure());
+        }
+
+        // The outgoing edges of a node are then contiguous, still in file order
+        stable_sort(edges.begin(), edges.end(), [](const Edge &e1, const Edge &e2) {
+            return e1.get_origin() < e2.get_origin();
+        });
+    }
+
+    for (const Edge &edge : edges) {
+        graph.add_edge(edge);
+    }
 
+    graph.update_profile();
+    return graph;
+}
 
-unsigned long Edge::get_flow() const {
-    return flow;
+template <class Index, class Weight>
+Index BasicGraph<Index, Weight>::to_internal_id(Index node) const {
+    return topology->to_internal.empty() ? node : topology->to_internal[node];
 }
 
-void Edge::set_flow(unsigned long flow) {
-    this->flow = flow;
+template <class Index, class Weight>
+Index BasicGraph<Index, Weight>::to_external_id(Index node) const {
+    return topology->to_external.empty() ? node : topology->to_external[node];
 }
 
-Graph::Graph(int n) : nodes(n + 1), n(n) {}
+template <class Index, class Weight>
+bool BasicGraph<Index, Weight>::fits(const File &file) {
+    const unsigned long max_index = numeric_limits<Index>::max();
+    const unsigned long max_weight = numeric_limits<Weight>::max();
+
+    vector<unsigned long> header = file.get_header();
+    if (header.size() < 2 || header[0] >= max_index || header[1] >= max_index) {
+        return false;
+    }
+
+    // Flows are bounded by the sum of all capacities and arrival times by the sum of all durations
+    unsigned long total_capacity = 0, total_duration = 0;
+    for (const FileEntry &entry : file.get_entries()) {
+        if (entry.size() < 4) {
+            continue;
+        }
+
+        total_capacity += entry[2];
+        total_duration += entry[3];
+        if (total_capacity >= max_weight || total_duration >= max_weight) {
+            return false;
+        }
 
-Graph::Graph(const Graph &g) : nodes(g.nodes), edges(g.edges), n(g.n) {}
+        // Scheduled arrivals must fit too
+        if (entry.size() > 4 && entry[4] >= max_weight - entry[3]) {
+            return false;
+        }
+    }
 
-void Graph::add_edge(const Edge &edge) {
+    return true;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::add_edge(const Edge &edge) {
     if (edge.get_origin() == 0 || edge.get_destination() == 0) {
         throw "Edge has origin or destination at 0";
     }
 
-    unsigned long index = edges.size();
-    edges.push_back(edge);
+    Topology &topology = mutable_topology();
+
+    // Compressed lists can't grow, so they're unpacked first
+    if (!topology.compressed.empty()) {
+        topology.adjacency.resize(n + 1);
+        for (Index i = 0; i <= n; i++) {
+            topology.adjacency[i] = topology.compressed.decode(i);
+        }
+
+        topology.compressed = CompressedAdjacency();
+    }
+
+    // The order and the capacity range may no longer hold, so the engines stop relying on them
+    if (topology.profile.valid) {
+        topology.profile.valid = false;
+        HugeVector<Index>().swap(topology.topological_order);
+        HugeVector<Index>().swap(topology.topological_position);
+    }
+
+    Index index = topology.edges.size();
+    topology.edges.push_back(edge);
 
-    nodes.at(edge.get_origin()).outgoing.push_back(index);
-    nodes.at(edge.get_destination()).incoming.push_back(index);
+    topology.adjacency.at(edge.get_origin()).outgoing.push_back(index);
+    topology.adjacency.at(edge.get_destination()).incoming.push_back(index);
+
+    flows.resize(topology.edges.size());
+
+    // Capacities set for this graph still cover every edge, the new one keeping its own
+    if (!capacities.empty()) {
+        capacities.push_back(edge.get_capacity());
+    }
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::max_capacity_dijkstra(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return max_capacity_dijkstra(adjacency, start); });
 }
 
-void Graph::max_capacity_dijkstra(unsigned long start) {
-    for (unsigned long i = 1; i <= n; i++) {
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::max_capacity_dijkstra(const Lists &adjacency, Index start) {
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    for (Index i = 1; i <= n; i++) {
         nodes.at(i).visited = false;
         nodes.at(i).parent = 0;
         nodes.at(i).capacity = 0;
     }
 
-    nodes.at(start).capacity = 999999;
+    nodes.at(start).capacity = numeric_limits<Weight>::max();
 
-    MaxHeap<int, unsigned long> maxh(n, -1);
+    MaxHeap<Index, Weight> &maxh = workspace.heap;
+    maxh.reset(n);
     maxh.insert(start, nodes[start].capacity);
 
-    while (maxh.get_size() > 0) {
-        unsigned int node = maxh.remove_max();
+    while (maxh.get_size() > 0 && !should_stop()) {
+        Index node = maxh.remove_max();
+        COUNT_STAT(nodes_settled);
         nodes.at(node).visited = true;
 
-        for (const unsigned long &e : nodes[node].outgoing) {
-            const Edge &edge = edges[e];
+        for (const Index &e : adjacency[node].outgoing) {
+            COUNT_STAT(edges_relaxed);
 
-            unsigned long dest = edge.get_destination();
-            if (nodes[dest].visited) {
+            Index dest = destinations[e];
+            if (nodes[dest].visited || !active[e]) {
                 continue;
             }
 
-            unsigned long minCap = min(nodes[node].capacity, edge.get_capacity());
+            Weight minCap = min(nodes[node].capacity, capacities[e]);
             if (minCap > nodes[dest].capacity) {
                 nodes[dest].capacity = minCap;
                 nodes[dest].parent = node;
-                
+
                 maxh.insert(dest, nodes[dest].capacity);
                 maxh.increase_key(dest, nodes[dest].capacity);
             }
@@ -113,44 +677,226 @@ void Graph::max_capacity_dijkstra(unsigned long start) {
     }
 }
 
-void Graph::pareto_optimal_dijkstra(unsigned long start, bool max_capacity) {
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::max_capacity_buckets(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return max_capacity_buckets(adjacency, start); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::max_capacity_buckets(const Lists &adjacency, Index start) {
+    const GraphProfile &profile = topology->profile;
+    if (!profile.valid || profile.max_capacity > BUCKET_QUEUE_LIMIT) {
+        return max_capacity_dijkstra(adjacency, start);
+    }
+
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    for (Index i = 1; i <= n; i++) {
+        nodes.at(i).visited = false;
+        nodes.at(i).parent = 0;
+        nodes.at(i).capacity = 0;
+    }
+
+    // A search that stopped may have left nodes behind
+    vector<vector<Index>> &buckets = workspace.buckets;
+    buckets.resize(max<size_t>(buckets.size(), profile.max_capacity + 1));
+    for (vector<Index> &bucket : buckets) {
+        bucket.clear();
+    }
+
+    // Pushes and pops of the buckets count as heap inserts and pops, so the costs of the engines compare
+    auto settle = [&](Index node) {
+        COUNT_STAT(nodes_settled);
+        nodes[node].visited = true;
+
+        for (const Index &e : adjacency[node].outgoing) {
+            COUNT_STAT(edges_relaxed);
+
+            Index dest = destinations[e];
+            if (nodes[dest].visited || !active[e]) {
+                continue;
+            }
+
+            Weight minCap = min(nodes[node].capacity, capacities[e]);
+            if (minCap > nodes[dest].capacity) {
+                nodes[dest].capacity = minCap;
+                nodes[dest].parent = node;
+
+                COUNT_STAT(heap_inserts);
+                buckets[minCap].push_back(dest);
+            }
+        }
+    };
+
+    // The start is wider than every bucket. Each bucket only gets nodes from itself or wider ones, so a node is
+    // final once its bucket is reached, and its entries in narrower buckets are skipped later
+    nodes.at(start).capacity = numeric_limits<Weight>::max();
+    settle(start);
+
+    for (Weight capacity = profile.max_capacity; capacity > 0 && !interrupted; capacity--) {
+        vector<Index> &bucket = buckets[capacity];
+
+        while (!bucket.empty() && !should_stop()) {
+            Index node = bucket.back();
+            bucket.pop_back();
+            COUNT_STAT(heap_pops);
+
+            if (!nodes[node].visited) {
+                settle(node);
+            }
+        }
+    }
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::max_capacity_dag_sweep(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return max_capacity_dag_sweep(adjacency, start); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::max_capacity_dag_sweep(const Lists &adjacency, Index start) {
+    if (!topology->profile.valid || !topology->profile.acyclic) {
+        return max_capacity_dijkstra(adjacency, start);
+    }
+
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+    const HugeVector<Index> &order = topology->topological_order;
+
+    for (Index i = 1; i <= n; i++) {
+        nodes.at(i).visited = false;
+        nodes.at(i).parent = 0;
+        nodes.at(i).capacity = 0;
+    }
+
+    nodes.at(start).capacity = numeric_limits<Weight>::max();
+
+    // Every edge into a node comes from earlier in the order, so its capacity is final when the sweep gets to it;
+    // nodes before the start can't be reached, and the ones still at 0 weren't
+    for (size_t i = topology->topological_position[start]; i < order.size() && !should_stop(); i++) {
+        Index node = order[i];
+        if (nodes[node].capacity == 0) {
+            continue;
+        }
+
+        COUNT_STAT(nodes_settled);
+        nodes[node].visited = true;
+
+        for (const Index &e : adjacency[node].outgoing) {
+            COUNT_STAT(edges_relaxed);
+
+            if (!active[e]) {
+                continue;
+            }
+
+            Index dest = destinations[e];
+            Weight minCap = min(nodes[node].capacity, capacities[e]);
+            if (minCap > nodes[dest].capacity) {
+                nodes[dest].capacity = minCap;
+                nodes[dest].parent = node;
+            }
+        }
+    }
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::widest_paths(Index start) {
+    WidestPathChoice choice = choose_widest_path_engine(topology->profile);
 
-    for (unsigned long i = 1; i <= n; i++) {
+    EngineReport &report = engine_report();
+    report.widest_path_used = true;
+    report.widest_path = choice;
+    report.profile = topology->profile;
+
+    auto started = chrono::steady_clock::now();
+    switch (choice.engine) {
+        case WidestPathEngine::BUCKET_QUEUE:
+            max_capacity_buckets(start);
+            break;
+        case WidestPathEngine::DAG_SWEEP:
+            max_capacity_dag_sweep(start);
+            break;
+        default:
+            max_capacity_dijkstra(start);
+    }
+
+    report.widest_path_milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+}
+
+template <class Index, class Weight>
+const GraphProfile &BasicGraph<Index, Weight>::get_profile() const {
+    return topology->profile;
+}
+
+template <class Index, class Weight>
+template <class Order>
+void BasicGraph<Index, Weight>::pareto_optimal_dijkstra(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return pareto_optimal_dijkstra<Order>(adjacency, start); });
+}
+
+template <class Index, class Weight>
+template <class Order, class Lists>
+void BasicGraph<Index, Weight>::pareto_optimal_dijkstra(const Lists &adjacency, Index start) {
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<Weight> &durations = edges.get_durations();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    for (Index i = 1; i <= n; i++) {
         nodes.at(i).visited = false;
         nodes.at(i).parent = 0;
         nodes.at(i).capacity = 0;
-        nodes.at(i).distance = 999999;
+        nodes.at(i).distance = numeric_limits<Weight>::max();
     }
 
-    nodes.at(start).capacity = 999999;
+    nodes.at(start).capacity = numeric_limits<Weight>::max();
     nodes.at(start).distance = 0;
 
-    MaxHeap<int, pair<long, long>> maxh(n, -1);
-    maxh.insert(start, 
-        max_capacity ? make_pair(nodes[start].capacity, -nodes[start].distance) : make_pair(-nodes[start].distance, nodes[start].capacity));
+    MaxHeap<Index, PackedKey<Weight>> &maxh = workspace.packed_heap;
+    maxh.reset(n);
+    maxh.insert(start, Order::key(nodes[start].capacity, nodes[start].distance));
 
-    while (maxh.get_size() > 0) {
-        unsigned int node = maxh.remove_max();
+    while (maxh.get_size() > 0 && !should_stop()) {
+        Index node = maxh.remove_max();
+        COUNT_STAT(nodes_settled);
         nodes.at(node).visited = true;
 
-        for (const unsigned long &e : nodes[node].outgoing) {
-            const Edge &edge =  edges[e];
+        for (const Index &e : adjacency[node].outgoing) {
+            COUNT_STAT(edges_relaxed);
 
-            unsigned long dest = edge.get_destination();
-            if (nodes[dest].visited) {
+            Index dest = destinations[e];
+            if (nodes[dest].visited || !active[e]) {
                 continue;
             }
 
-            unsigned long minCap = min(nodes[node].capacity, edge.get_capacity());
+            Weight minCap = min(nodes[node].capacity, capacities[e]);
+            Weight distance = nodes[node].distance + Order::cost(durations[e]);
+
+            PackedKey<Weight> possibleWeight = Order::key(minCap, distance);
+            PackedKey<Weight> currWeight = Order::key(nodes[dest].capacity, nodes[dest].distance);
 
-            pair<long, long> possibleWeight = max_capacity ? make_pair(minCap, -nodes[node].distance - 1) : make_pair(-nodes[node].distance - 1, minCap);
-            pair<long, long> currWeight = max_capacity ? make_pair(nodes[dest].capacity, -nodes[dest].distance) : make_pair(-nodes[dest].distance, nodes[dest].capacity);
-            
             if (possibleWeight > currWeight) {
                 nodes[dest].capacity = minCap;
-                nodes[dest].distance = nodes[node].distance + 1;
+                nodes[dest].distance = distance;
                 nodes[dest].parent = node;
-                
+
                 maxh.insert(dest, possibleWeight);
                 maxh.increase_key(dest, possibleWeight);
             }
@@ -159,95 +905,413 @@ void Graph::pareto_optimal_dijkstra(unsigned long start, bool max_capacity) {
 }
 
 
-unsigned long Graph::size() {
-    return n;
-}
+template <class Index, class Weight>
+Index BasicGraph<Index, Weight>::size() const {
+    return n;
+}
+
+template <class Index, class Weight>
+Index BasicGraph<Index, Weight>::edge_count() const {
+    return topology->edges.size();
+}
+
+template <class Index, class Weight>
+BasicEdge<Index, Weight> BasicGraph<Index, Weight>::get_edge(Index e) const {
+    return topology->edges.at(e);
+}
+
+template <class Index, class Weight>
+BasicAdjacency<Index> BasicGraph<Index, Weight>::get_adjacency(Index node) const {
+    if (node > n) {
+        throw out_of_range("Invalid node id");
+    }
+
+    return is_compressed() ? topology->compressed.decode(node) : topology->adjacency[node];
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::compress_adjacency() {
+    if (is_compressed()) {
+        return;
+    }
+
+    TRACE_SPAN("compress");
+
+    Topology &topology = mutable_topology();
+    topology.compressed.build(topology.adjacency);
+    HugeVector<Adjacency>().swap(topology.adjacency);
+}
+
+template <class Index, class Weight>
+bool BasicGraph<Index, Weight>::is_compressed() const {
+    return !topology->compressed.empty();
+}
+
+template <class Index, class Weight>
+shared_ptr<const typename BasicGraph<Index, Weight>::Topology> BasicGraph<Index, Weight>::get_topology() const {
+    return topology;
+}
+
+template <class Index, class Weight>
+size_t BasicGraph<Index, Weight>::memory_usage() const {
+    size_t bytes = sizeof(Topology) + topology->edges.memory_usage() + flows.memory_usage() + capacities.capacity() * sizeof(Weight);
+    bytes += (topology->to_internal.capacity() + topology->to_external.capacity()) * sizeof(Index);
+    bytes += (topology->topological_order.capacity() + topology->topological_position.capacity()) * sizeof(Index);
+
+    bytes += topology->adjacency.capacity() * sizeof(Adjacency) + topology->compressed.memory_usage();
+    for (const Adjacency &adjacency : topology->adjacency) {
+        bytes += (adjacency.outgoing.capacity() + adjacency.incoming.capacity()) * sizeof(Index);
+    }
+
+    return bytes;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::set_capacities(const HugeVector<Weight> &capacities) {
+    if (!capacities.empty() && capacities.size() != topology->edges.size()) {
+        throw invalid_argument("There must be a capacity for every edge");
+    }
+
+    this->capacities = capacities;
+}
+
+template <class Index, class Weight>
+const HugeVector<Weight> &BasicGraph<Index, Weight>::get_capacities() const {
+    return capacities.empty() ? topology->edges.get_capacities() : capacities;
+}
+
+template <class Index, class Weight>
+Weight BasicGraph<Index, Weight>::get_flow(Index e) const {
+    return flows.get(e);
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::set_flow(Index e, Weight flow) {
+    flows.set(e, flow);
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::clear_flows() {
+    flows.clear();
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::set_active(Index e, bool active) {
+    mutable_topology().edges.set_active(e, active);
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::set_cancellation(const CancellationToken &token) {
+    cancellation = token;
+    until_poll = 1;
+    interrupted = false;
+}
+
+template <class Index, class Weight>
+bool BasicGraph<Index, Weight>::was_interrupted() const {
+    return interrupted;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::max_flow_increase_bfs(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return max_flow_increase_bfs(adjacency, start); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::max_flow_increase_bfs(const Lists &adjacency, Index start) {
+    COUNT_STAT(bfs_passes);
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
 
-void Graph::max_flow_increase_bfs(unsigned long start) {
-    for (unsigned long i = 1; i <= n; i++) {
+    for (Index i = 1; i <= n; i++) {
         nodes.at(i).visited = false;
         nodes.at(i).parent = 0;
         nodes.at(i).flow_increase = 0;
     }
 
-    queue<unsigned long> next;
-    next.push(start);
-    
-    nodes.at(start).flow_increase = 999999;
+    // A vector read from the front, rather than a queue, keeps its storage between passes
+    HugeVector<Index> &next = workspace.queue;
+    next.clear();
+    next.push_back(start);
 
-    while (!next.empty()) {
-        unsigned long curr = next.front(); next.pop();
+    nodes.at(start).flow_increase = numeric_limits<Weight>::max();
+
+    for (size_t head = 0; head < next.size() && !should_stop(); head++) {
+        Index curr = next[head];
+        COUNT_STAT(nodes_settled);
         Node &curr_node = nodes.at(curr);
 
         curr_node.visited = true;
 
-        for (unsigned long e : curr_node.outgoing) {
-            Edge &edge = edges.at(e);
-            Node &destination = nodes.at(edge.get_destination());
+        for (Index e : adjacency[curr].outgoing) {
+            COUNT_STAT(edges_relaxed);
+            Node &destination = nodes.at(destinations[e]);
 
-            if (destination.visited) {
+            if (destination.visited || !active[e]) {
                 continue;
             }
 
-            unsigned long flow_increase = min(curr_node.flow_increase, edge.get_capacity() - edge.get_flow());
+            Weight flow_increase = min(curr_node.flow_increase, capacities[e] - flows.get(e));
             if (flow_increase > 0) {
                 destination.flow_increase = flow_increase;
                 destination.parent = e;
 
-                next.push(edge.get_destination());
+                next.push_back(destinations[e]);
             }
-            
+
         }
 
-        for (unsigned long e : curr_node.incoming) {
-            Edge &edge = edges.at(e);
-            Node &origin = nodes.at(edge.get_origin());
+        for (Index e : adjacency[curr].incoming) {
+            COUNT_STAT(edges_relaxed);
+            Node &origin = nodes.at(origins[e]);
 
-            if (origin.visited) {
+            if (origin.visited || !active[e]) {
                 continue;
             }
 
-            unsigned long flow_increase = min(curr_node.flow_increase, edge.get_flow());
+            Weight flow_increase = min(curr_node.flow_increase, flows.get(e));
             if (flow_increase > 0) {
                 origin.flow_increase = flow_increase;
                 origin.parent = e;
 
-                next.push(edge.get_origin());
+                next.push_back(origins[e]);
             }
         }
     }
 }
 
 
-tuple<list<unsigned long>, unsigned long, unsigned long> Graph::get_path(unsigned long start, unsigned long end) {
-    list<unsigned long> path;
-    if (!nodes[end].visited) {
-        return { path, 0, 0 };
+template <class Index, class Weight>
+tuple<list<Index>, Weight, Weight> BasicGraph<Index, Weight>::get_path(Index start, Index end) {
+    vector<Index> path;
+    auto [capacity, distance] = get_path(start, end, path);
+
+    return { list<Index>(path.begin(), path.end()), capacity, distance };
+}
+
+template <class Index, class Weight>
+pair<Weight, Weight> BasicGraph<Index, Weight>::get_path(Index /*start*/, Index end, vector<Index> &path) {
+    TRACE_SPAN("path");
+
+    const HugeVector<Node> &nodes = workspace.nodes;
+    end = to_internal_id(end);
+
+    // A search that stopped before settling the end may still have reached it, over settled nodes only
+    path.clear();
+    if (!nodes[end].visited && (!interrupted || nodes[end].parent == 0)) {
+        return { 0, 0 };
     }
 
-    unsigned long currNode = end;
+    // The path is walked backwards from the end, so it is reversed in place afterwards
+    Index currNode = end;
     while (nodes[currNode].parent != 0) {
-        path.push_front(currNode);
+        path.push_back(to_external_id(currNode));
         currNode = nodes[currNode].parent;
     }
 
-    path.push_front(currNode);
+    path.push_back(to_external_id(currNode));
+    reverse(path.begin(), path.end());
 
-    return { path, nodes[end].capacity, nodes[end].distance };
+    return { nodes[end].capacity, nodes[end].distance };
 }
 
-tuple<list<unsigned long>, unsigned long, unsigned long> Graph::get_max_capacity_path(unsigned long start, unsigned long end) {
-    max_capacity_dijkstra(start);
+template <class Index, class Weight>
+tuple<list<Index>, Weight, Weight> BasicGraph<Index, Weight>::get_max_capacity_path(Index start, Index end) {
+    widest_paths(to_internal_id(start));
     return get_path(start, end);
 }
 
-tuple<list<unsigned long>, unsigned long, unsigned long> Graph::get_pareto_optimal_path(unsigned long start, unsigned long end, bool max_capacity) {
-    pareto_optimal_dijkstra(start, max_capacity);
-    return get_path(start, end);
+template <class Index, class Weight>
+pair<Weight, Weight> BasicGraph<Index, Weight>::get_max_capacity_path(Index start, Index end, vector<Index> &path) {
+    widest_paths(to_internal_id(start));
+    return get_path(start, end, path);
+}
+
+template <class Index, class Weight>
+tuple<list<Index>, Weight, Weight> BasicGraph<Index, Weight>::get_pareto_optimal_path(Index start, Index end, PathOrder order) {
+    vector<Index> path;
+    auto [capacity, distance] = get_pareto_optimal_path(start, end, order, path);
+
+    return { list<Index>(path.begin(), path.end()), capacity, distance };
+}
+
+template <class Index, class Weight>
+pair<Weight, Weight> BasicGraph<Index, Weight>::get_pareto_optimal_path(Index start, Index end, PathOrder order, vector<Index> &path) {
+    // Dispatch once per query, so that each ordering gets its own branch-free search
+    switch (order) {
+        case PathOrder::CAPACITY_FIRST:
+            pareto_optimal_dijkstra<CapacityFirst>(to_internal_id(start));
+            break;
+        case PathOrder::HOPS_FIRST:
+            pareto_optimal_dijkstra<HopsFirst>(to_internal_id(start));
+            break;
+        case PathOrder::DURATION_AWARE:
+            pareto_optimal_dijkstra<DurationAware>(to_internal_id(start));
+            break;
+    }
+
+    return get_path(start, end, path);
+}
+
+template <class Index, class Weight>
+vector<Weight> BasicGraph<Index, Weight>::remaining_duration_bounds(Index end) const {
+    return topology->visit_adjacency([&](const auto &adjacency) { return remaining_duration_bounds(adjacency, end); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+vector<Weight> BasicGraph<Index, Weight>::remaining_duration_bounds(const Lists &adjacency, Index end) const {
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Weight> &durations = edges.get_durations();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    const Weight unreachable = numeric_limits<Weight>::max();
+    vector<Weight> remaining(n + 1, unreachable);
+    vector<bool> settled(n + 1, false);
+    remaining[end] = 0;
+
+    // A max heap on the inverted duration pops the shortest duration first
+    MaxHeap<Index, Weight> maxh(n, 0);
+    maxh.insert(end, unreachable);
+
+    while (maxh.get_size() > 0 && !should_stop()) {
+        Index node = maxh.remove_max();
+        COUNT_STAT(nodes_settled);
+        settled[node] = true;
+
+        for (Index e : adjacency[node].incoming) {
+            COUNT_STAT(edges_relaxed);
+
+            Index origin = origins[e];
+            if (settled[origin] || !active[e] || durations[e] >= unreachable - remaining[node]) {
+                continue;
+            }
+
+            Weight duration = remaining[node] + durations[e];
+            if (duration < remaining[origin]) {
+                remaining[origin] = duration;
+
+                maxh.insert(origin, unreachable - duration);
+                maxh.increase_key(origin, unreachable - duration);
+            }
+        }
+    }
+
+    return remaining;
 }
 
-void Graph::biggest_duration(unsigned long start) {
-    for (unsigned long i = 1; i <= n; i++) {
+template <class Index, class Weight>
+tuple<list<Index>, Weight, Weight> BasicGraph<Index, Weight>::get_budgeted_path(Index start, Index end, Weight budget) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return get_budgeted_path(adjacency, start, end, budget); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+tuple<list<Index>, Weight, Weight> BasicGraph<Index, Weight>::get_budgeted_path(const Lists &adjacency, Index start, Index end, Weight budget) {
+    TRACE_SPAN("search");
+
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<Weight> &durations = edges.get_durations();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    struct Label {
+        Index node;
+        Index parent;
+        Weight capacity;
+        Weight duration;
+    };
+
+    start = to_internal_id(start);
+    end = to_internal_id(end);
+
+    vector<Weight> remaining = remaining_duration_bounds(end);
+    if (remaining[start] > budget) {
+        return { {}, 0, 0 };
+    }
+
+    // The shortest duration of the labels settled at each node, which all have a bigger or equal capacity
+    vector<Weight> settled_duration(n + 1, numeric_limits<Weight>::max());
+
+    vector<Label> labels;
+    labels.push_back({ start, 0, numeric_limits<Weight>::max(), 0 });
+
+    // Labels are popped by decreasing capacity, then increasing duration
+    priority_queue<pair<PackedKey<Weight>, Index>> queue;
+    queue.push({ CapacityFirst::key<Weight>(labels[0].capacity, 0), 0 });
+
+    while (!queue.empty() && !should_stop()) {
+        Index l = queue.top().second; queue.pop();
+        COUNT_STAT(nodes_settled);
+        const Label label = labels[l];
+
+        if (label.duration >= settled_duration[label.node]) {
+            continue;
+        }
+        settled_duration[label.node] = label.duration;
+
+        if (label.node == end) {
+            list<Index> path;
+            for (Index curr = l; curr != 0; curr = labels[curr].parent) {
+                path.push_front(to_external_id(labels[curr].node));
+            }
+            path.push_front(to_external_id(start));
+
+            return { path, label.capacity, label.duration };
+        }
+
+        for (Index e : adjacency[label.node].outgoing) {
+            COUNT_STAT(edges_relaxed);
+
+            Index dest = destinations[e];
+            if (!active[e] || capacities[e] == 0) {
+                continue;
+            }
+
+            // Dropped if it can't make the budget, or if a label settled there is at least as wide and as fast
+            Weight left = budget - label.duration;
+            if (durations[e] > left || remaining[dest] > left - durations[e]) {
+                continue;
+            }
+
+            Weight duration = label.duration + durations[e];
+            if (duration >= settled_duration[dest]) {
+                continue;
+            }
+
+            Weight capacity = min(label.capacity, capacities[e]);
+            labels.push_back({ dest, l, capacity, duration });
+            queue.push({ CapacityFirst::key<Weight>(capacity, duration), (Index) (labels.size() - 1) });
+        }
+    }
+
+    return { {}, 0, 0 };
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::biggest_duration(Index start) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return biggest_duration(adjacency, start); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::biggest_duration(const Lists &adjacency, Index start) {
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &durations = edges.get_durations();
+
+    for (Index i = 1; i <= n; i++) {
         Node &node = nodes[i];
 
         node.parent = 0;
@@ -257,34 +1321,36 @@ void Graph::biggest_duration(unsigned long start) {
         node.in_degree = 0;
     }
 
-    for (Edge &edge : edges) {
-        if (edge.get_flow() > 0) {
-            Node &node = nodes[edge.get_destination()];
-            node.in_degree += 1;
-        }
+    workspace.flowing.clear();
+    flows.nonzero(workspace.flowing);
+
+    for (Index e : workspace.flowing) {
+        nodes[destinations[e]].in_degree += 1;
     }
 
-    queue<unsigned long> next;
-    next.push(start);
+    HugeVector<Index> &next = workspace.queue;
+    next.clear();
+    next.push_back(start);
 
-    while (!next.empty()) {
-        unsigned long index = next.front(); next.pop();
+    for (size_t head = 0; head < next.size() && !should_stop(); head++) {
+        Index index = next[head];
+        COUNT_STAT(nodes_settled);
         Node &node = nodes[index];
 
         node.visited = true;
 
-        for (unsigned long e : node.outgoing) {
-            const Edge &edge = edges[e];
-            if (edge.get_flow() == 0) {
+        for (Index e : adjacency[index].outgoing) {
+            COUNT_STAT(edges_relaxed);
+            if (flows.get(e) == 0) {
                 continue;
             }
 
-            Node &neighbor = nodes[edge.get_destination()];
+            Node &neighbor = nodes[destinations[e]];
             if (neighbor.visited) {
                 continue;
             }
-            
-            unsigned long end = node.earliest_start + edge.get_duration();
+
+            Weight end = node.earliest_start + durations[e];
 
             if (neighbor.earliest_start < end) {
                 neighbor.earliest_start = end;
@@ -293,13 +1359,19 @@ void Graph::biggest_duration(unsigned long start) {
 
             neighbor.in_degree -= 1;
             if (neighbor.in_degree == 0) {
-                next.push(edge.get_destination());
+                next.push_back(destinations[e]);
             }
         }
     }
 }
 
-void Graph::edmonds_karp(unsigned long start, unsigned long end, unsigned long flow_increase) {    
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::edmonds_karp(Index start, Index end, Weight flow_increase) {
+    TRACE_SPAN("search");
+
+    const HugeVector<Node> &nodes = workspace.nodes;
+
+    // A path found by a search that stopped is still whole, so it's taken before stopping
     while (flow_increase > 0) {
         max_flow_increase_bfs(start);
 
@@ -307,69 +1379,332 @@ void Graph::edmonds_karp(unsigned long start, unsigned long end, unsigned long f
             break;
         }
 
-        unsigned long increment = nodes.at(end).flow_increase;
+        Weight increment = augment(start, end);
+        flow_increase -= min(flow_increase, increment); // prevent overflow
+
+        if (interrupted) {
+            break;
+        }
+    }
+}
 
-        unsigned long curr = end;
-        while (curr != start) {
-            
-            Node &curr_node = nodes.at(curr);
-            Edge &edge = edges.at(curr_node.parent);
+template <class Index, class Weight>
+Weight BasicGraph<Index, Weight>::augment(Index start, Index end) {
+    const HugeVector<Node> &nodes = workspace.nodes;
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+
+    Weight increment = nodes.at(end).flow_increase;
+    COUNT_STAT(augmentations);
+
+    Index curr = end;
+    while (curr != start) {
+        Index e = nodes.at(curr).parent;
+
+        if (curr == destinations.at(e)) {
+            flows.set(e, flows.get(e) + increment);
+            curr = origins[e];
+        } else {
+            flows.set(e, flows.get(e) - increment);
+            curr = destinations[e];
+        }
+    }
 
-            if (curr == edge.get_destination()) {
-                edge.set_flow(edge.get_flow() + increment);
-                curr = edge.get_origin();
-            } else {
-                edge.set_flow(edge.get_flow() - increment);
-                curr = edge.get_destination();
+    return increment;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::blocking_flow(Index start, Index end) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return blocking_flow(adjacency, start, end, 1); });
+}
+
+/*
+ * Only residual edges of at least threshold are followed, so that capacity scaling can leave the narrow ones for
+ * later phases. A threshold of 1 follows every residual edge.
+ */
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::blocking_flow(const Lists &adjacency, Index start, Index end, Weight threshold) {
+    TRACE_SPAN("search");
+
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    const Index UNREACHED = numeric_limits<Index>::max();
+    HugeVector<Index> &levels = workspace.levels;
+    HugeVector<Index> &arcs = workspace.arcs;
+    HugeVector<Index> &path = workspace.path;
+    HugeVector<Index> &next = workspace.queue;
+    levels.resize(n + 1);
+    arcs.resize(n + 1);
+
+    // The residual capacity of an edge walked from a node, forwards from its origin or backwards from its destination
+    auto residual = [&](Index e, Index from) {
+        return from == origins[e] ? capacities[e] - flows.get(e) : flows.get(e);
+    };
+    auto other_end = [&](Index e, Index from) {
+        return from == origins[e] ? destinations[e] : origins[e];
+    };
+
+    while (!interrupted) {
+        COUNT_STAT(bfs_passes);
+
+        // Levels the residual graph, stopping once the level of the end is done
+        fill(levels.begin(), levels.end(), UNREACHED);
+        levels[start] = 0;
+        next.clear();
+        next.push_back(start);
+
+        for (size_t head = 0; head < next.size() && !should_stop(); head++) {
+            Index curr = next[head];
+            if (levels[end] != UNREACHED && levels[curr] >= levels[end]) {
+                break;
             }
+            COUNT_STAT(nodes_settled);
+
+            auto level = [&](const auto &list) {
+                for (Index e : list) {
+                    COUNT_STAT(edges_relaxed);
+
+                    Index other = other_end(e, curr);
+                    if (levels[other] == UNREACHED && active[e] && residual(e, curr) >= threshold) {
+                        levels[other] = levels[curr] + 1;
+                        next.push_back(other);
+                    }
+                }
+            };
+
+            const auto &lists = adjacency[curr];
+            level(lists.outgoing);
+            level(lists.incoming);
         }
 
+        if (levels[end] == UNREACHED || interrupted) {
+            break;
+        }
 
-        flow_increase -= min(flow_increase, increment); // prevent overflow
+        // Extends a path from the start along edges one level up, resuming each node's scan at its current arc,
+        // counted over its outgoing edges and then its incoming ones. A dead end is taken out of the level graph,
+        // and reaching the end saturates the path and backs up to before its first edge left below the threshold
+        fill(arcs.begin(), arcs.end(), 0);
+        path.clear();
+        Index curr = start;
+
+        while (!should_stop()) {
+            if (curr == end) {
+                Weight increment = numeric_limits<Weight>::max();
+                Index from = start;
+                for (Index e : path) {
+                    increment = min(increment, residual(e, from));
+                    from = other_end(e, from);
+                }
+
+                COUNT_STAT(augmentations);
+                size_t saturated = path.size();
+                from = start;
+                for (size_t i = 0; i < path.size(); i++) {
+                    Index e = path[i];
+                    bool forward = from == origins[e];
+
+                    flows.set(e, forward ? flows.get(e) + increment : flows.get(e) - increment);
+                    if (saturated == path.size() && residual(e, from) < threshold) {
+                        saturated = i;
+                        curr = from;
+                    }
+                    from = forward ? destinations[e] : origins[e];
+                }
+
+                path.resize(saturated);
+                continue;
+            }
+
+            Index &arc = arcs[curr];
+            bool found = false;
+
+            // Moves the current arc to the next edge one level up in a list starting at offset, if there is one,
+            // and returns the position after the list. Plain lists jump to the current arc, compressed ones have
+            // to decode the edges before it
+            auto scan = [&](const auto &list, Index offset) {
+                Index i = offset;
+                auto it = list.begin(), last = list.end();
+
+                if constexpr (is_same_v<Lists, HugeVector<Adjacency>>) {
+                    Index skip = min<Index>(max(arc, offset) - offset, list.size());
+                    it += skip;
+                    i += skip;
+                } else {
+                    for (; i < arc && it != last; ++i, ++it) {}
+                }
+
+                for (; it != last; ++it, ++i) {
+                    COUNT_STAT(edges_relaxed);
+
+                    Index e = *it;
+                    if (levels[other_end(e, curr)] == levels[curr] + 1 && active[e] && residual(e, curr) >= threshold) {
+                        arc = i;
+                        found = true;
+                        path.push_back(e);
+                        return i;
+                    }
+                }
+
+                arc = max(arc, i);
+                return i;
+            };
+
+            const auto &lists = adjacency[curr];
+            Index after_outgoing = scan(lists.outgoing, 0);
+            if (!found) {
+                scan(lists.incoming, after_outgoing);
+            }
+
+            if (found) {
+                curr = other_end(path.back(), curr);
+                continue;
+            }
+
+            if (curr == start) {
+                break;
+            }
+
+            levels[curr] = UNREACHED;
+            Index e = path.back();
+            path.pop_back();
+            curr = other_end(e, curr);
+        }
     }
 }
 
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::capacity_scaling(Index start, Index end) {
+    const GraphProfile &profile = topology->profile;
+    if (!profile.valid) {
+        return blocking_flow(start, end);
+    }
+
+    // From the biggest power of two no bigger than the biggest capacity down to 1
+    Weight threshold = 1;
+    while (threshold <= profile.max_capacity / 2) {
+        threshold *= 2;
+    }
 
-list<tuple<unsigned long, unsigned long, unsigned long>> Graph::get_flow_path() {
-    list<tuple<unsigned long, unsigned long, unsigned long>> path;
-    for (Edge &edge : edges) {
-        if (edge.get_flow() > 0) {
-            path.push_back({ edge.get_origin(), edge.get_destination(), edge.get_flow() });
+    topology->visit_adjacency([&](const auto &adjacency) {
+        for (; threshold > 0 && !interrupted; threshold /= 2) {
+            blocking_flow(adjacency, start, end, threshold);
         }
+    });
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::max_flow(Index start, Index end, Weight flow_increase, bool routed) {
+    FlowChoice choice = choose_flow_engine(topology->profile, flow_increase != numeric_limits<Weight>::max(), routed);
+
+    EngineReport &report = engine_report();
+    report.flow_used = true;
+    report.flow = choice;
+    report.profile = topology->profile;
+
+    auto started = chrono::steady_clock::now();
+    switch (choice.engine) {
+        case FlowEngine::BLOCKING_FLOW:
+            blocking_flow(start, end);
+            break;
+        case FlowEngine::CAPACITY_SCALING:
+            capacity_scaling(start, end);
+            break;
+        default:
+            edmonds_karp(start, end, flow_increase);
     }
 
-    return path;
+    report.flow_milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+}
+
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_flow_path() {
+    vector<tuple<Index, Index, Weight>> path;
+    get_flow_path(path);
+
+    return list<tuple<Index, Index, Weight>>(path.begin(), path.end());
 }
 
-list<tuple<unsigned long, unsigned long, unsigned long>> Graph::get_path_for_group_of_size(unsigned long start, unsigned long end, unsigned long size) {
-    for (Edge &edge : edges) {
-        edge.set_flow(0);
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_flow_path(vector<tuple<Index, Index, Weight>> &path) {
+    TRACE_SPAN("path");
+
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+
+    path.clear();
+    HugeVector<Index> &flowing = workspace.flowing;
+    flowing.clear();
+    flows.nonzero(flowing);
+
+    // One pass over the flow column finds the edges with flow, so only those few are gathered and sorted
+    for (Index e : flowing) {
+        path.push_back({ to_external_id(origins[e]), to_external_id(destinations[e]), flows.get(e) });
     }
 
+    sort(path.begin(), path.end());
+}
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_path_for_group_of_size(Index start, Index end, Weight size) {
+    flows.clear();
+
     return get_path_with_increment(start, end, size);
 }
 
-list<tuple<unsigned long, unsigned long, unsigned long>> Graph::get_path_with_increment(unsigned long start, unsigned long end, unsigned long increment) {
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_path_for_group_of_size(Index start, Index end, Weight size, vector<tuple<Index, Index, Weight>> &path) {
+    flows.clear();
+
+    get_path_with_increment(start, end, size, path);
+}
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_path_with_increment(Index start, Index end, Weight increment) {
     if (start != end) {
-        edmonds_karp(start, end, increment);
+        max_flow(to_internal_id(start), to_internal_id(end), increment, true);
     }
-    
+
     return get_flow_path();
 }
 
-list<tuple<unsigned long, unsigned long, unsigned long>> Graph::get_path_for_group_of_max_size(unsigned long start, unsigned long end) {
-        for (Edge &edge : edges) {
-        edge.set_flow(0);
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_path_with_increment(Index start, Index end, Weight increment, vector<tuple<Index, Index, Weight>> &path) {
+    if (start != end) {
+        max_flow(to_internal_id(start), to_internal_id(end), increment, true);
     }
 
-    return get_path_with_increment(start, end, numeric_limits<unsigned long>::max());
+    get_flow_path(path);
+}
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_path_for_group_of_max_size(Index start, Index end) {
+    flows.clear();
+
+    return get_path_with_increment(start, end, numeric_limits<Weight>::max());
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_path_for_group_of_max_size(Index start, Index end, vector<tuple<Index, Index, Weight>> &path) {
+    flows.clear();
+
+    get_path_with_increment(start, end, numeric_limits<Weight>::max(), path);
 }
 
 
-unsigned long Graph::get_earliest_meetup(unsigned long start, unsigned long end) {
-    biggest_duration(start);
+template <class Index, class Weight>
+Weight BasicGraph<Index, Weight>::get_earliest_meetup(Index start, Index end) {
+    biggest_duration(to_internal_id(start));
 
-    Node &destination = nodes[end];
+    const Node &destination = workspace.nodes[to_internal_id(end)];
     if (!destination.visited || destination.in_degree > 0) {
         return 0;
     } else {
@@ -377,36 +1712,438 @@ unsigned long Graph::get_earliest_meetup(unsigned long start, unsigned long end)
     }
 }
 
-list<pair<unsigned long, unsigned int>> Graph::get_waiting_periods(unsigned long start, unsigned long end) {
-    biggest_duration(start);
+template <class Index, class Weight>
+list<pair<Index, Weight>> BasicGraph<Index, Weight>::get_waiting_periods(Index start, Index end) {
+    vector<pair<Index, Weight>> waiting_periods;
+    get_waiting_periods(start, end, waiting_periods);
 
-    list<pair<unsigned long, unsigned int>> waiting_periods;
+    return list<pair<Index, Weight>>(waiting_periods.begin(), waiting_periods.end());
+}
 
-    for (unsigned long i = 1; i <= n; i++) {
-        Node &node = nodes[i];
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_waiting_periods(Index start, Index end, vector<pair<Index, Weight>> &waiting_periods) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return get_waiting_periods(adjacency, start, end, waiting_periods); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::get_waiting_periods(const Lists &adjacency, Index start, Index /*end*/, vector<pair<Index, Weight>> &waiting_periods) {
+    biggest_duration(to_internal_id(start));
+    TRACE_SPAN("path");
 
-        unsigned long earliest_arrival = node.earliest_start;
+    const HugeVector<Node> &nodes = workspace.nodes;
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Weight> &durations = edges.get_durations();
+
+    waiting_periods.clear();
+
+    for (Index i = 1; i <= n; i++) {
+        const Node &node = nodes[to_internal_id(i)];
+
+        // After a stop, only the nodes taken from the queue had all their arrivals
+        if (interrupted && !node.visited) {
+            continue;
+        }
 
-        for (unsigned long e : node.incoming) {
-            const Edge &edge = edges[e];
+        Weight earliest_arrival = node.earliest_start;
 
-            if (edge.get_flow() == 0) {
+        for (Index e : adjacency[to_internal_id(i)].incoming) {
+            if (flows.get(e) == 0) {
                 continue;
             }
 
-            const Node &previous = nodes[edge.get_origin()];
-            unsigned long arrival = previous.earliest_start + edge.get_duration();
+            const Node &previous = nodes[origins[e]];
+            Weight arrival = previous.earliest_start + durations[e];
             if (arrival < earliest_arrival) {
                 earliest_arrival = arrival;
             }
         }
 
         if (earliest_arrival < node.earliest_start) {
-            unsigned long wait = node.earliest_start - earliest_arrival;
+            Weight wait = node.earliest_start - earliest_arrival;
             waiting_periods.push_back({ i, wait });
         }
     }
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::residual_widest_paths(Index start, Index end) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return residual_widest_paths(adjacency, start, end); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+void BasicGraph<Index, Weight>::residual_widest_paths(const Lists &adjacency, Index start, Index end) {
+    TRACE_SPAN("search");
+
+    HugeVector<Node> &nodes = prepare_nodes();
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    for (Index i = 1; i <= n; i++) {
+        nodes[i].visited = false;
+        nodes[i].capacity = 0;
+        nodes[i].flow_increase = 0;
+    }
+
+    // Forward pass: widest residual path from start to every node
+    nodes[start].capacity = numeric_limits<Weight>::max();
+
+    MaxHeap<Index, Weight> forward(n, 0);
+    forward.insert(start, nodes[start].capacity);
+
+    while (forward.get_size() > 0 && !should_stop()) {
+        Index node = forward.remove_max();
+        COUNT_STAT(nodes_settled);
+        nodes[node].visited = true;
+
+        auto relax = [&](Index next, Weight residual) {
+            COUNT_STAT(edges_relaxed);
+            Weight width = min(nodes[node].capacity, residual);
+            if (!nodes[next].visited && width > nodes[next].capacity) {
+                nodes[next].capacity = width;
+                forward.insert(next, width);
+                forward.increase_key(next, width);
+            }
+        };
+
+        for (Index e : adjacency[node].outgoing) {
+            if (active[e]) {
+                relax(destinations[e], capacities[e] - flows.get(e));
+            }
+        }
+
+        for (Index e : adjacency[node].incoming) {
+            if (active[e]) {
+                relax(origins[e], flows.get(e));
+            }
+        }
+    }
+
+    // Backward pass: widest residual path from every node to end, following residual edges in reverse
+    vector<bool> settled(n + 1, false);
+    nodes[end].flow_increase = numeric_limits<Weight>::max();
+
+    MaxHeap<Index, Weight> backward(n, 0);
+    backward.insert(end, nodes[end].flow_increase);
+
+    while (backward.get_size() > 0 && !should_stop()) {
+        Index node = backward.remove_max();
+        COUNT_STAT(nodes_settled);
+        settled[node] = true;
+
+        auto relax = [&](Index previous, Weight residual) {
+            COUNT_STAT(edges_relaxed);
+            Weight width = min(nodes[node].flow_increase, residual);
+            if (!settled[previous] && width > nodes[previous].flow_increase) {
+                nodes[previous].flow_increase = width;
+                backward.insert(previous, width);
+                backward.increase_key(previous, width);
+            }
+        };
+
+        for (Index e : adjacency[node].incoming) {
+            if (active[e]) {
+                relax(origins[e], capacities[e] - flows.get(e));
+            }
+        }
+
+        for (Index e : adjacency[node].outgoing) {
+            if (active[e]) {
+                relax(destinations[e], flows.get(e));
+            }
+        }
+    }
+}
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_min_cut(Index start, Index end) {
+    list<tuple<Index, Index, Weight>> cut, critical;
+    get_bottlenecks(start, end, cut, critical);
+
+    return cut;
+}
+
+template <class Index, class Weight>
+list<tuple<Index, Index, Weight>> BasicGraph<Index, Weight>::get_critical_edges(Index start, Index end) {
+    list<tuple<Index, Index, Weight>> cut, critical;
+    get_bottlenecks(start, end, cut, critical);
+
+    return critical;
+}
+
+template <class Index, class Weight>
+void BasicGraph<Index, Weight>::get_bottlenecks(Index start, Index end, list<tuple<Index, Index, Weight>> &cut, list<tuple<Index, Index, Weight>> &critical) {
+    cut.clear();
+    critical.clear();
+    if (start == end) {
+        return;
+    }
+
+    start = to_internal_id(start);
+    end = to_internal_id(end);
+
+    // The current flow may be between other points, so the maximum flow starts from none, and the current one is
+    // put back afterwards, which only swaps the chunks it shares
+    FlowOverlay<Weight> kept = flows;
+    flows.clear();
+
+    max_flow(start, end, numeric_limits<Weight>::max(), false);
+    residual_widest_paths(start, end);
+
+    // Short of the maximum flow, the nodes reached in the residual graph don't make a cut
+    if (!interrupted) {
+        const HugeVector<Node> &nodes = workspace.nodes;
+        const EdgeTable &edges = topology->edges;
+        const HugeVector<Index> &origins = edges.get_origins();
+        const HugeVector<Index> &destinations = edges.get_destinations();
+        const HugeVector<Weight> &capacities = get_capacities();
+        const HugeVector<uint8_t> &active = edges.get_active();
+
+        for (Index e = 0; e < edges.size(); e++) {
+            const Node &origin = nodes[origins[e]];
+            const Node &destination = nodes[destinations[e]];
+
+            // A cancelled bus is not on any route, so it neither separates the two sides nor limits the flow
+            if (!active[e]) {
+                continue;
+            }
+
+            if (origin.visited && !destination.visited) {
+                cut.push_back({ to_external_id(origins[e]), to_external_id(destinations[e]), capacities[e] });
+            }
+
+            if (flows.get(e) < capacities[e]) {
+                continue;
+            }
+
+            Weight gain = min(origin.capacity, destination.flow_increase);
+            if (gain > 0) {
+                critical.push_back({ to_external_id(origins[e]), to_external_id(destinations[e]), gain });
+            }
+        }
+
+        critical.sort([](const auto &t1, const auto &t2) {
+            return get<2>(t1) > get<2>(t2);
+        });
+    }
+
+    flows = move(kept);
+}
+
+template <class Index, class Weight>
+vector<BasicReplacementPath<Index, Weight>> BasicGraph<Index, Weight>::get_replacement_paths(Index start, Index end) {
+    return topology->visit_adjacency([&](const auto &adjacency) { return get_replacement_paths(adjacency, start, end); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+vector<BasicReplacementPath<Index, Weight>> BasicGraph<Index, Weight>::get_replacement_paths(const Lists &adjacency, Index start, Index end) {
+    vector<BasicReplacementPath<Index, Weight>> replacements;
+
+    start = to_internal_id(start);
+    end = to_internal_id(end);
+
+    // Forward tree: the widest path from start to every node, the route itself being the path to end
+    // It comes from the same engine as get_max_capacity_path, so it is the route printed next to the replacements
+    widest_paths(start);
+
+    const HugeVector<Node> &nodes = workspace.nodes;
+    const EdgeTable &edges = topology->edges;
+    const HugeVector<Index> &origins = edges.get_origins();
+    const HugeVector<Index> &destinations = edges.get_destinations();
+    const HugeVector<Weight> &capacities = get_capacities();
+    const HugeVector<uint8_t> &active = edges.get_active();
+
+    if (start == end || !nodes[end].visited || interrupted) {
+        return replacements;
+    }
+
+    vector<Index> route;
+    for (Index curr = end; curr != start; curr = nodes[curr].parent) {
+        route.push_back(curr);
+    }
+    route.push_back(start);
+    reverse(route.begin(), route.end());
+
+    // The edge taken at each step of the route, the widest one if there are parallel edges
+    vector<Index> route_edges;
+    for (Index i = 0; i + 1 < route.size(); i++) {
+        Index taken = 0;
+        Weight widest = 0;
+        for (Index e : adjacency[route[i]].outgoing) {
+            if (active[e] && destinations[e] == route[i + 1] && capacities[e] >= widest) {
+                taken = e;
+                widest = capacities[e];
+            }
+        }
+        route_edges.push_back(taken);
+    }
+
+    // The position of the last node of the route on each node's forward tree path
+    // A node's tree path uses the i-th edge of the route if, and only if, that position is bigger than i
+    const Index none = numeric_limits<Index>::max();
+    vector<Index> branch(n + 1, none);
+    for (Index i = 0; i < route.size(); i++) {
+        branch[route[i]] = i;
+    }
+
+    vector<Index> pending;
+    for (Index i = 1; i <= n; i++) {
+        Index curr = i;
+        while (nodes[curr].visited && branch[curr] == none) {
+            pending.push_back(curr);
+            curr = nodes[curr].parent;
+        }
+
+        for (Index node : pending) {
+            branch[node] = branch[curr];
+        }
+        pending.clear();
+    }
+
+    // Backward tree: the widest path from every node to end
+    vector<Weight> to_end(n + 1, 0);
+    vector<Index> successor(n + 1, 0);
+    vector<bool> settled(n + 1, false);
+    to_end[end] = numeric_limits<Weight>::max();
+
+    MaxHeap<Index, Weight> maxh(n, 0);
+    maxh.insert(end, to_end[end]);
+
+    while (maxh.get_size() > 0 && !should_stop()) {
+        Index node = maxh.remove_max();
+        COUNT_STAT(nodes_settled);
+        settled[node] = true;
+
+        for (Index e : adjacency[node].incoming) {
+            COUNT_STAT(edges_relaxed);
+
+            Index origin = origins[e];
+            if (settled[origin] || !active[e]) {
+                continue;
+            }
+
+            Weight minCap = min(to_end[node], capacities[e]);
+            if (minCap > to_end[origin]) {
+                to_end[origin] = minCap;
+                successor[origin] = node;
+
+                maxh.insert(origin, minCap);
+                maxh.increase_key(origin, minCap);
+            }
+        }
+    }
+
+    if (interrupted) {
+        return replacements;
+    }
+
+    // Every other edge bridges the cancellations of the route edges between the branches of its two ends
+    vector<tuple<Weight, Index, Index, Index>> bridges; // capacity, first and last cancelled edge, bridge
+    for (Index e = 0; e < edges.size(); e++) {
+        Index origin = origins[e], destination = destinations[e];
+
+        if (!active[e] || !nodes[origin].visited || branch[destination] == none || !settled[destination]) {
+            continue;
+        }
+
+        if (branch[origin] >= branch[destination] || (branch[origin] < route_edges.size() && route_edges[branch[origin]] == e)) {
+            continue;
+        }
+
+        Weight capacity = min({ nodes[origin].capacity, capacities[e], to_end[destination] });
+        if (capacity > 0) {
+            bridges.push_back({ capacity, branch[origin], branch[destination] - 1, e });
+        }
+    }
+
+    // Widest bridges first, each cancellation taking the first bridge that covers it
+    sort(bridges.begin(), bridges.end(), [](const auto &b1, const auto &b2) {
+        return get<0>(b1) > get<0>(b2);
+    });
+
+    Index length = route.size() - 1;
+    vector<Index> best(length, none);
+    vector<Index> next_free(length + 1);
+    for (Index i = 0; i <= length; i++) {
+        next_free[i] = i;
+    }
+
+    auto find_free = [&](Index i) {
+        Index root = i;
+        while (next_free[root] != root) root = next_free[root];
+        while (next_free[i] != root) { Index up = next_free[i]; next_free[i] = root; i = up; }
+        return root;
+    };
+
+    for (Index b = 0; b < bridges.size(); b++) {
+        auto [capacity, first, last, e] = bridges[b];
+        for (Index i = find_free(first); i <= last; i = find_free(i)) {
+            best[i] = b;
+            next_free[i] = i + 1;
+        }
+    }
+
+    for (Index i = 0; i < length; i++) {
+        BasicReplacementPath<Index, Weight> replacement{ to_external_id(route[i]), to_external_id(route[i + 1]), {}, 0 };
+
+        if (best[i] != none) {
+            auto [capacity, first, last, e] = bridges[best[i]];
+            replacement.capacity = capacity;
+
+            for (Index curr = origins[e]; curr != start; curr = nodes[curr].parent) {
+                replacement.path.push_front(to_external_id(curr));
+            }
+            replacement.path.push_front(to_external_id(start));
+
+            for (Index curr = destinations[e]; curr != end; curr = successor[curr]) {
+                replacement.path.push_back(to_external_id(curr));
+            }
+            replacement.path.push_back(to_external_id(end));
+        }
+
+        replacements.push_back(replacement);
+    }
+
+    return replacements;
+}
+
+AnyGraph load_graph(const File &file, NodeOrder order) {
+    TRACE_SPAN("build");
+
+    if (Graph::fits(file)) {
+        return Graph::from_file(file, order);
+    }
+
+    return WideGraph::from_file(file, order);
+}
+
+NodeOrder parse_node_order(const string &name) {
+    if (name == "file") return NodeOrder::FILE;
+    if (name == "bfs") return NodeOrder::BFS;
+    if (name == "topological") return NodeOrder::TOPOLOGICAL;
+    if (name == "rcm") return NodeOrder::RCM;
 
-    return waiting_periods;
+    throw invalid_argument("Unknown node order " + name);
 }
 
+template class BasicCompressedAdjacency<uint32_t>;
+template class BasicEdge<uint32_t, uint32_t>;
+template class BasicEdgeTable<uint32_t, uint32_t>;
+template class BasicGraph<uint32_t, uint32_t>;
+template void BasicGraph<uint32_t, uint32_t>::pareto_optimal_dijkstra<CapacityFirst>(uint32_t);
+template void BasicGraph<uint32_t, uint32_t>::pareto_optimal_dijkstra<HopsFirst>(uint32_t);
+template void BasicGraph<uint32_t, uint32_t>::pareto_optimal_dijkstra<DurationAware>(uint32_t);
+
+template class BasicCompressedAdjacency<uint64_t>;
+template class BasicEdge<uint64_t, uint64_t>;
+template class BasicEdgeTable<uint64_t, uint64_t>;
+template class BasicGraph<uint64_t, uint64_t>;
+template void BasicGraph<uint64_t, uint64_t>::pareto_optimal_dijkstra<CapacityFirst>(uint64_t);
+template void BasicGraph<uint64_t, uint64_t>::pareto_optimal_dijkstra<HopsFirst>(uint64_t);
+template void BasicGraph<uint64_t, uint64_t>::pareto_optimal_dijkstra<DurationAware>(uint64_t);
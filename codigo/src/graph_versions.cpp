@@ -0,0 +1,131 @@
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "graph_versions.h"
+#include "dataset.h"
+#include "trace.h"
+
+using namespace std;
+
+/** @brief How often the loading thread looks for retired versions that can be freed */
+static const chrono::milliseconds RECLAIM_INTERVAL(20);
+
+/** @brief How much the loading thread yields to the queries, on Linux, where threads have their own niceness */
+static const int LOADER_NICENESS = 10;
+
+GraphVersions::~GraphVersions() {
+    stopping = true;
+    wait();
+}
+
+shared_ptr<const GraphVersion> GraphVersions::acquire() const {
+    return current.load(memory_order_acquire);
+}
+
+uint64_t GraphVersions::get_version() const {
+    return published.load(memory_order_acquire);
+}
+
+void GraphVersions::publish(AnyGraph graph, const string &name) {
+    uint64_t number = published.load(memory_order_relaxed) + 1;
+    shared_ptr<const GraphVersion> version = make_shared<const GraphVersion>(GraphVersion{ move(graph), name, number });
+
+    shared_ptr<const GraphVersion> previous = current.exchange(move(version), memory_order_acq_rel);
+    published.store(number, memory_order_release);
+
+    if (previous) {
+        lock_guard<mutex> lock(retired_mutex);
+        retired.push_back(move(previous));
+    }
+}
+
+bool GraphVersions::load_in_background(const string &file, NodeOrder order) {
+    return build_in_background([file, order]() {
+        File dataset(file);
+        return load_graph(dataset, order);
+    }, file);
+}
+
+bool GraphVersions::build_in_background(function<AnyGraph()> build, const string &name) {
+    if (loading.exchange(true)) {
+        return false;
+    }
+
+    // The previous loader has published, but may still be waiting for readers to release what it replaced. The
+    // new one takes that over
+    superseded = true;
+    if (loader.joinable()) {
+        loader.join();
+    }
+    superseded = false;
+
+    loader = thread(&GraphVersions::run_loader, this, move(build), name);
+    return true;
+}
+
+void GraphVersions::run_loader(function<AnyGraph()> build, string name) {
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, gettid(), LOADER_NICENESS);
+#endif
+
+    try {
+        TRACE_SPAN("background load");
+        publish(build(), name);
+    } catch (exception &e) {
+        lock_guard<mutex> lock(error_mutex);
+        error = name + ": " + e.what();
+    }
+
+    loading = false;
+
+    // The grace period: queries that started on the old version still hold it
+    while (reclaim() > 0 && !stopping && !superseded) {
+        this_thread::sleep_for(RECLAIM_INTERVAL);
+    }
+}
+
+bool GraphVersions::is_loading() const {
+    return loading;
+}
+
+void GraphVersions::wait() {
+    if (loader.joinable()) {
+        loader.join();
+    }
+}
+
+string GraphVersions::take_error() {
+    lock_guard<mutex> lock(error_mutex);
+
+    string taken;
+    taken.swap(error);
+    return taken;
+}
+
+size_t GraphVersions::reclaim() {
+    vector<shared_ptr<const GraphVersion>> released;
+
+    {
+        lock_guard<mutex> lock(retired_mutex);
+
+        for (size_t i = 0; i < retired.size(); ) {
+            if (retired[i].use_count() == 1) {
+                released.push_back(move(retired[i]));
+                retired[i] = move(retired.back());
+                retired.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // Freed here, outside the lock
+    released.clear();
+
+    lock_guard<mutex> lock(retired_mutex);
+    return retired.size();
+}
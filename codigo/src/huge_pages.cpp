@@ -0,0 +1,185 @@
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+#include "huge_pages.h"
+
+using namespace std;
+
+/** @brief An array mapped for huge pages */
+struct Region {
+    size_t length;
+    bool from_pool;
+    bool advised;
+};
+
+static atomic<HugePages> mode{ HugePages::OFF };
+
+/** @brief The mapped arrays by address, which also tells huge_deallocate how each array was allocated */
+static mutex regions_mutex;
+static map<uintptr_t, Region> regions;
+
+void set_huge_pages(HugePages new_mode) {
+    mode = new_mode;
+}
+
+HugePages get_huge_pages() {
+    return mode;
+}
+
+HugePages parse_huge_pages(const string &name) {
+    if (name == "off") return HugePages::OFF;
+    if (name == "transparent") return HugePages::TRANSPARENT;
+    if (name == "explicit") return HugePages::EXPLICIT;
+
+    throw invalid_argument("Unknown huge page mode " + name + ", expected off, transparent or explicit");
+}
+
+/**
+ * @brief Maps an array from the reserved pool of huge pages
+ *
+ * @return The array, nullptr if the pool can't hold it
+ */
+static void *map_from_pool(size_t length) {
+#ifdef MAP_HUGETLB
+    void *array = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (array != MAP_FAILED) {
+        return array;
+    }
+#endif
+
+    return nullptr;
+}
+
+/**
+ * @brief Maps an array aligned to a huge page, so that the kernel can back all of it with transparent huge pages
+ *
+ * @return The array, nullptr if memory ran out
+ */
+static void *map_aligned(size_t length) {
+    // Mapping a huge page more than needed leaves room to trim an aligned array out of it
+    size_t padded = length + HUGE_PAGE_SIZE;
+    void *mapped = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    if (aligned > start) {
+        munmap(mapped, aligned - start);
+    }
+    if (start + padded > aligned + length) {
+        munmap(reinterpret_cast<void *>(aligned + length), start + padded - aligned - length);
+    }
+
+    return reinterpret_cast<void *>(aligned);
+}
+
+void *huge_allocate(size_t bytes) {
+    HugePages current = mode;
+    if (current == HugePages::OFF || bytes < HUGE_PAGE_SIZE) {
+        return ::operator new(bytes);
+    }
+
+    size_t length = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    Region region = { length, false, false };
+
+    void *array = current == HugePages::EXPLICIT ? map_from_pool(length) : nullptr;
+    if (array) {
+        region.from_pool = true;
+    } else {
+        array = map_aligned(length);
+        if (!array) {
+            throw bad_alloc();
+        }
+
+#ifdef MADV_HUGEPAGE
+        region.advised = madvise(array, length, MADV_HUGEPAGE) == 0;
+#endif
+    }
+
+    lock_guard<mutex> lock(regions_mutex);
+    regions[reinterpret_cast<uintptr_t>(array)] = region;
+    return array;
+}
+
+void huge_deallocate(void *array, size_t bytes) {
+    if (bytes >= HUGE_PAGE_SIZE) {
+        unique_lock<mutex> lock(regions_mutex);
+
+        // Arrays allocated while the mode was OFF came from the allocator
+        auto it = regions.find(reinterpret_cast<uintptr_t>(array));
+        if (it != regions.end()) {
+            size_t length = it->second.length;
+            regions.erase(it);
+            lock.unlock();
+
+            munmap(array, length);
+            return;
+        }
+    }
+
+    ::operator delete(array);
+}
+
+/**
+ * @brief Adds up the transparent huge pages of the mappings that overlap the regions
+ *
+ * The kernel may merge a region with its neighbors into one mapping, in which case the neighbors' huge pages are
+ * counted too. As only advised mappings get transparent huge pages unless they're enabled for everything, those
+ * neighbors are almost always other regions.
+ */
+static size_t read_transparent_bytes(const map<uintptr_t, Region> &regions) {
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    bool overlaps = false;
+    size_t bytes = 0;
+
+    while (getline(smaps, line)) {
+        uintptr_t start, end;
+        char dash;
+        istringstream fields(line);
+
+        // Each mapping starts with its range, followed by lines of named fields
+        if (fields >> hex >> start >> dash >> end && dash == '-') {
+            auto it = regions.lower_bound(end);
+            overlaps = it != regions.begin() && prev(it)->first + prev(it)->second.length > start;
+            continue;
+        }
+
+        if (overlaps && line.rfind("AnonHugePages:", 0) == 0) {
+            size_t kib = 0;
+            istringstream(line.substr(14)) >> kib;
+            bytes += kib << 10;
+        }
+    }
+
+    return bytes;
+}
+
+HugePageReport huge_page_report() {
+    map<uintptr_t, Region> current;
+    {
+        lock_guard<mutex> lock(regions_mutex);
+        current = regions;
+    }
+
+    HugePageReport report = { current.size(), 0, 0, 0, 0 };
+    for (const auto &[address, region] : current) {
+        report.bytes += region.length;
+        report.explicit_bytes += region.from_pool ? region.length : 0;
+        report.advised_bytes += region.advised ? region.length : 0;
+    }
+
+    report.transparent_bytes = current.empty() ? 0 : read_transparent_bytes(current);
+    return report;
+}
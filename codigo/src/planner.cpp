@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+#include "planner.h"
+
+using namespace std;
+
+template <class Index, class Weight>
+BasicGroupPlanner<Index, Weight>::BasicGroupPlanner(const BasicGraph<Index, Weight> &graph) {
+    plan.graph = graph;
+    plan.graph.clear_flows();
+
+    parent.resize(graph.size() + 1);
+    bottleneck.resize(graph.size() + 1);
+    seen.resize(graph.size() + 1);
+}
+
+template <class Index, class Weight>
+void BasicGroupPlanner<Index, Weight>::add_group(const Group &group) {
+    if (group.start == 0 || group.end == 0 || group.start > plan.graph.size() || group.end > plan.graph.size()) {
+        throw invalid_argument("Group has an invalid starting or ending point");
+    }
+
+    groups.push_back(group);
+}
+
+template <class Index, class Weight>
+Weight BasicGroupPlanner<Index, Weight>::requested(size_t g) const {
+    return min<unsigned long>(groups[g].size, numeric_limits<Weight>::max());
+}
+
+template <class Index, class Weight>
+bool BasicGroupPlanner<Index, Weight>::find_augmenting_path(const Plan &plan, size_t g) {
+    return plan.graph.get_topology()->visit_adjacency([&](const auto &adjacency) { return find_augmenting_path(adjacency, plan, g); });
+}
+
+template <class Index, class Weight>
+template <class Lists>
+bool BasicGroupPlanner<Index, Weight>::find_augmenting_path(const Lists &adjacency, const Plan &plan, size_t g) {
+    auto topology = plan.graph.get_topology();
+    const HugeVector<Index> &origins = topology->edges.get_origins();
+    const HugeVector<Index> &destinations = topology->edges.get_destinations();
+    const HugeVector<Weight> &capacities = plan.graph.get_capacities();
+    const HugeVector<uint8_t> &active = topology->edges.get_active();
+    const GroupFlow &own = plan.group_flows[g];
+    Index start = plan.graph.to_internal_id(groups[g].start), end = plan.graph.to_internal_id(groups[g].end);
+
+    // Stamping avoids clearing the visited marks before every search
+    if (++stamp == 0) {
+        fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+
+    next.clear();
+    next.push_back(start);
+    seen[start] = stamp;
+    bottleneck[start] = numeric_limits<Weight>::max();
+
+    for (size_t i = 0; i < next.size(); i++) {
+        Index curr = next[i];
+
+        for (Index e : adjacency[curr].outgoing) {
+            Index dest = destinations[e];
+            if (seen[dest] == stamp || !active[e]) {
+                continue;
+            }
+
+            Weight spare = capacities[e] - plan.graph.get_flow(e);
+            if (spare == 0) {
+                continue;
+            }
+
+            seen[dest] = stamp;
+            parent[dest] = e;
+            bottleneck[dest] = min(bottleneck[curr], spare);
+            if (dest == end) {
+                return true;
+            }
+
+            next.push_back(dest);
+        }
+
+        if (own.empty()) {
+            continue;
+        }
+
+        for (Index e : adjacency[curr].incoming) {
+            Index origin = origins[e];
+            if (seen[origin] == stamp) {
+                continue;
+            }
+
+            auto it = own.find(e);
+            if (it == own.end()) {
+                continue;
+            }
+
+            seen[origin] = stamp;
+            parent[origin] = e;
+            bottleneck[origin] = min(bottleneck[curr], it->second);
+            if (origin == end) {
+                return true;
+            }
+
+            next.push_back(origin);
+        }
+    }
+
+    return false;
+}
+
+template <class Index, class Weight>
+Weight BasicGroupPlanner<Index, Weight>::route(Plan &plan, size_t g, Weight amount) {
+    Index start = plan.graph.to_internal_id(groups[g].start), end = plan.graph.to_internal_id(groups[g].end);
+    if (start == end) {
+        return 0;
+    }
+
+    auto topology = plan.graph.get_topology();
+    const HugeVector<Index> &origins = topology->edges.get_origins();
+    const HugeVector<Index> &destinations = topology->edges.get_destinations();
+    GroupFlow &own = plan.group_flows[g];
+    Weight routed = 0;
+
+    while (routed < amount && find_augmenting_path(plan, g)) {
+        Weight increment = min(bottleneck[end], amount - routed);
+
+        Index curr = end;
+        while (curr != start) {
+            Index e = parent[curr];
+
+            if (curr == destinations[e]) {
+                plan.graph.set_flow(e, plan.graph.get_flow(e) + increment);
+                own[e] += increment;
+                curr = origins[e];
+            } else {
+                plan.graph.set_flow(e, plan.graph.get_flow(e) - increment);
+                if ((own[e] -= increment) == 0) {
+                    own.erase(e);
+                }
+                curr = destinations[e];
+            }
+        }
+
+        routed += increment;
+    }
+
+    plan.routed[g] += routed;
+    plan.total += routed;
+    return routed;
+}
+
+template <class Index, class Weight>
+void BasicGroupPlanner<Index, Weight>::rip_up(Plan &plan, size_t g) {
+    for (const auto &[e, flow] : plan.group_flows[g]) {
+        plan.graph.set_flow(e, plan.graph.get_flow(e) - flow);
+    }
+
+    plan.group_flows[g].clear();
+    plan.total -= plan.routed[g];
+    plan.routed[g] = 0;
+}
+
+template <class Index, class Weight>
+vector<size_t> BasicGroupPlanner<Index, Weight>::blocking_groups(const Plan &plan, size_t g) {
+    auto topology = plan.graph.get_topology();
+    const HugeVector<Index> &destinations = topology->edges.get_destinations();
+    const HugeVector<Weight> &capacities = plan.graph.get_capacities();
+
+    // The group can't be routed further, so the search marks every node it can still reach
+    find_augmenting_path(plan, g);
+
+    unordered_set<Index> saturated;
+    topology->visit_adjacency([&](const auto &adjacency) {
+        for (Index curr : next) {
+            for (Index e : adjacency[curr].outgoing) {
+                if (seen[destinations[e]] != stamp && plan.graph.get_flow(e) == capacities[e]) {
+                    saturated.insert(e);
+                }
+            }
+        }
+    });
+
+    vector<size_t> blocking;
+    for (size_t other = 0; other < groups.size(); other++) {
+        if (other == g) {
+            continue;
+        }
+
+        for (const auto &[e, flow] : plan.group_flows[other]) {
+            if (saturated.count(e)) {
+                blocking.push_back(other);
+                break;
+            }
+        }
+    }
+
+    return blocking;
+}
+
+template <class Index, class Weight>
+vector<BasicGroupRoute<Index, Weight>> BasicGroupPlanner<Index, Weight>::plan_groups(unsigned rounds) {
+    plan.graph.clear_flows();
+    plan.group_flows.assign(groups.size(), GroupFlow());
+    plan.routed.assign(groups.size(), 0);
+    plan.total = 0;
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        route(plan, g, requested(g));
+    }
+
+    for (unsigned round = 0; round < rounds; round++) {
+        bool improved = false;
+
+        for (size_t g = 0; g < groups.size(); g++) {
+            // Capacity freed by earlier rounds may be enough on its own
+            route(plan, g, requested(g) - plan.routed[g]);
+            if (plan.routed[g] >= requested(g)) {
+                continue;
+            }
+
+            vector<size_t> blocking = blocking_groups(plan, g);
+            if (blocking.empty()) {
+                continue;
+            }
+
+            // The trial only moves the flow of g and of the groups blocking it, so only their shares are kept to
+            // put back, rather than a copy of the whole plan
+            vector<size_t> rerouted = blocking;
+            rerouted.push_back(g);
+
+            vector<GroupFlow> kept_flows;
+            vector<Weight> kept_routed;
+            for (size_t other : rerouted) {
+                kept_flows.push_back(plan.group_flows[other]);
+                kept_routed.push_back(plan.routed[other]);
+            }
+            Weight kept_total = plan.total;
+
+            for (size_t other : blocking) {
+                rip_up(plan, other);
+            }
+
+            route(plan, g, requested(g) - plan.routed[g]);
+            for (size_t other : blocking) {
+                route(plan, other, requested(other));
+            }
+
+            if (plan.total > kept_total) {
+                improved = true;
+                continue;
+            }
+
+            for (size_t other : rerouted) {
+                rip_up(plan, other);
+            }
+
+            for (size_t i = 0; i < rerouted.size(); i++) {
+                for (const auto &[e, flow] : kept_flows[i]) {
+                    plan.graph.set_flow(e, plan.graph.get_flow(e) + flow);
+                }
+
+                plan.group_flows[rerouted[i]] = std::move(kept_flows[i]);
+                plan.routed[rerouted[i]] = kept_routed[i];
+            }
+            plan.total = kept_total;
+        }
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    auto topology = plan.graph.get_topology();
+    vector<BasicGroupRoute<Index, Weight>> routes;
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        BasicGroupRoute<Index, Weight> route{ groups[g], plan.routed[g], {} };
+
+        for (const auto &[e, flow] : plan.group_flows[g]) {
+            const Edge &edge = topology->edges[e];
+            route.flow_path.push_back({ plan.graph.to_external_id(edge.get_origin()), plan.graph.to_external_id(edge.get_destination()), flow });
+        }
+
+        sort(route.flow_path.begin(), route.flow_path.end());
+        routes.push_back(std::move(route));
+    }
+
+    return routes;
+}
+
+template <class Index, class Weight>
+const BasicGraph<Index, Weight> &BasicGroupPlanner<Index, Weight>::get_graph() const {
+    return plan.graph;
+}
+
+template <class Index, class Weight>
+vector<tuple<Index, Index, Weight>> BasicGroupPlanner<Index, Weight>::get_residual_capacity() const {
+    auto topology = plan.graph.get_topology();
+    vector<tuple<Index, Index, Weight>> residual;
+
+    for (Index e = 0; e < topology->edges.size(); e++) {
+        Weight flow = plan.graph.get_flow(e);
+        if (flow > 0) {
+            const Edge &edge = topology->edges[e];
+            residual.push_back({ plan.graph.to_external_id(edge.get_origin()), plan.graph.to_external_id(edge.get_destination()), plan.graph.get_capacities()[e] - flow });
+        }
+    }
+
+    sort(residual.begin(), residual.end());
+    return residual;
+}
+
+template class BasicGroupPlanner<uint32_t, uint32_t>;
+template class BasicGroupPlanner<uint64_t, uint64_t>;
@@ -0,0 +1,186 @@
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include "result_writer.h"
+
+using namespace std;
+
+ResultWriter::ResultWriter(ostream &out, OutputFormat format) : out(out), format(format), buffer(1 << 16) {}
+
+ResultWriter::~ResultWriter() {
+    finish();
+}
+
+void ResultWriter::reserve(size_t bytes) {
+    if (buffer.size() - used < bytes) {
+        out.write(buffer.data(), used);
+        used = 0;
+    }
+}
+
+void ResultWriter::put(const char *text, size_t length) {
+    reserve(length);
+
+    // Text bigger than the whole buffer goes straight to the stream
+    if (length > buffer.size()) {
+        out.write(text, length);
+        return;
+    }
+
+    memcpy(buffer.data() + used, text, length);
+    used += length;
+}
+
+void ResultWriter::put(const char *text) {
+    put(text, strlen(text));
+}
+
+void ResultWriter::put(unsigned long value) {
+    reserve(20);
+    used = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data();
+}
+
+void ResultWriter::put(double value) {
+    reserve(32);
+
+    auto result = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value, chars_format::fixed, 2);
+    if (result.ec == errc()) {
+        used = result.ptr - buffer.data();
+    }
+}
+
+void ResultWriter::put_pattern(const char *pattern, initializer_list<unsigned long> values) {
+    auto value = values.begin();
+
+    for (const char *hole; (hole = strstr(pattern, "{}")) != nullptr && value != values.end(); pattern = hole + 2) {
+        put(pattern, hole - pattern);
+        put(*value++);
+    }
+
+    put(pattern);
+}
+
+void ResultWriter::begin_field(const char *name) {
+    if (format == OutputFormat::JSON) {
+        put(first_field ? "{\"" : ", \"");
+        put(name);
+        put("\": ");
+    }
+
+    first_field = false;
+}
+
+void ResultWriter::text(const char *text) {
+    if (format == OutputFormat::TEXT) {
+        put(text);
+        first_field = false;
+    }
+}
+
+void ResultWriter::begin_table(const char *name, initializer_list<const char *> columns, const char *row_pattern) {
+    begin_field(name);
+
+    this->row_pattern = row_pattern;
+    this->columns.assign(columns);
+    first_row = true;
+
+    if (format == OutputFormat::CSV) {
+        for (size_t i = 0; i < this->columns.size(); i++) {
+            put(i == 0 ? "" : ",");
+            put(this->columns[i]);
+        }
+        put("\n");
+    } else if (format == OutputFormat::JSON) {
+        put("[");
+    }
+}
+
+void ResultWriter::row(initializer_list<unsigned long> values) {
+    if (format == OutputFormat::TEXT) {
+        put_pattern(row_pattern, values);
+        return;
+    }
+
+    if (format == OutputFormat::JSON) {
+        put(first_row ? "{\"" : ", {\"");
+    }
+
+    size_t i = 0;
+    for (unsigned long value : values) {
+        if (format == OutputFormat::CSV) {
+            put(i == 0 ? "" : ",");
+        } else {
+            put(i == 0 ? "" : ", \"");
+            put(i < columns.size() ? columns[i] : "");
+            put("\": ");
+        }
+
+        put(value);
+        i++;
+    }
+
+    put(format == OutputFormat::CSV ? "\n" : "}");
+    first_row = false;
+}
+
+void ResultWriter::end_table() {
+    if (format == OutputFormat::CSV) {
+        put("\n");
+    } else if (format == OutputFormat::JSON) {
+        put("]");
+    }
+}
+
+void ResultWriter::value(const char *name, const char *pattern, unsigned long value) {
+    begin_field(name);
+
+    if (format == OutputFormat::TEXT) {
+        put_pattern(pattern, { value });
+    } else if (format == OutputFormat::CSV) {
+        put(name);
+        put("\n");
+        put(value);
+        put("\n\n");
+    } else {
+        put(value);
+    }
+}
+
+void ResultWriter::decimal(const char *name, const char *pattern, double value) {
+    begin_field(name);
+
+    if (format == OutputFormat::TEXT) {
+        const char *hole = strstr(pattern, "{}");
+        if (hole == nullptr) {
+            put(pattern);
+            return;
+        }
+
+        put(pattern, hole - pattern);
+        put(value);
+        put(hole + 2);
+    } else if (format == OutputFormat::CSV) {
+        put(name);
+        put("\n");
+        put(value);
+        put("\n\n");
+    } else {
+        put(value);
+    }
+}
+
+void ResultWriter::finish() {
+    if (first_field) {
+        return;
+    }
+
+    if (format == OutputFormat::JSON) {
+        put("}\n");
+    }
+
+    out.write(buffer.data(), used);
+    out.flush();
+
+    used = 0;
+    first_field = true;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+#include "simulator.h"
+
+using namespace std;
+
+/**
+ * @brief Mixes the bits of a number, so that close seeds give unrelated streams
+ *
+ * @param x The number
+ * @return The mixed number
+ */
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+template <class Weight>
+Weight BasicSimulationResult<Weight>::percentile(const vector<Weight> &values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    size_t rank = (size_t) ceil(p / 100 * values.size());
+    return values[min(max<size_t>(rank, 1), values.size()) - 1];
+}
+
+template <class Weight>
+double BasicSimulationResult<Weight>::mean(const vector<Weight> &values) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    double sum = 0;
+    for (Weight value : values) {
+        sum += value;
+    }
+
+    return sum / values.size();
+}
+
+template <class Index, class Weight>
+BasicCapacitySimulator<Index, Weight>::BasicCapacitySimulator(const BasicGraph<Index, Weight> &graph, const CapacityModel &model)
+    : graph(graph), model(model) {
+    this->graph.clear_flows();
+}
+
+template <class Index, class Weight>
+void BasicCapacitySimulator<Index, Weight>::draw_capacities(HugeVector<Weight> &capacities, uint64_t seed, uint64_t sample) const {
+    mt19937_64 rng(splitmix64(seed ^ splitmix64(sample)));
+    bernoulli_distribution cancelled(model.cancel_probability);
+    uniform_real_distribution<double> uniform(model.low, model.high);
+
+    // A normal distribution needs a positive deviation, even unused, and with none the fill factor is just the mean
+    bool constant = model.deviation <= 0;
+    normal_distribution<double> normal(model.mean, constant ? 1 : model.deviation);
+
+    const HugeVector<Weight> &nominal = graph.get_capacities();
+    const HugeVector<uint8_t> &active = graph.get_topology()->edges.get_active();
+    for (size_t e = 0; e < nominal.size(); e++) {
+        if (!active[e] || cancelled(rng)) {
+            capacities[e] = 0;
+            continue;
+        }
+
+        double factor = model.distribution == Perturbation::UNIFORM ? uniform(rng) : constant ? model.mean : normal(rng);
+        factor = min(max(factor, 0.0), 1.0);
+
+        double scaled = floor(nominal[e] * factor);
+        capacities[e] = scaled >= (double) nominal[e] ? nominal[e] : (Weight) scaled;
+    }
+}
+
+template <class Index, class Weight>
+Weight BasicCapacitySimulator<Index, Weight>::flow_size(const Graph &graph, Index start) {
+    return graph.get_topology()->visit_adjacency([&](const auto &adjacency) {
+        Weight size = 0;
+        for (Index e : adjacency[start].outgoing) {
+            size += graph.get_flow(e);
+        }
+        for (Index e : adjacency[start].incoming) {
+            size -= graph.get_flow(e);
+        }
+
+        return size;
+    });
+}
+
+template <class Index, class Weight>
+BasicSimulationResult<Weight> BasicCapacitySimulator<Index, Weight>::simulate(Index start, Index end, uint64_t samples, uint64_t seed, unsigned threads,
+                                                                              const CancellationToken &token) const {
+    if (threads == 0) {
+        threads = max(thread::hardware_concurrency(), 1u);
+    }
+    threads = (unsigned) min<uint64_t>(threads, max<uint64_t>(samples, 1));
+
+    Index first = graph.to_internal_id(start), last = graph.to_internal_id(end);
+
+    // Each sample writes to its own slot, so the results come out in the same order whatever the thread count
+    vector<Weight> max_sizes(samples), meetups(samples);
+    vector<uint8_t> finished(samples, 0);
+    atomic<uint64_t> next_sample = 0;
+
+    // Samples are long enough that the token can be polled before each one
+    auto worker = [&]() {
+        Graph trial = graph;
+        HugeVector<Weight> capacities(graph.get_topology()->edges.size());
+
+        for (uint64_t sample = next_sample++; sample < samples && !token.poll(); sample = next_sample++) {
+            draw_capacities(capacities, seed, sample);
+            trial.set_capacities(capacities);
+            trial.clear_flows();
+
+            // Routed like Scenario 2.3, so that the meetup is the one Scenario 2.4 would give for this sample
+            if (first != last) {
+                trial.max_flow(first, last, numeric_limits<Weight>::max(), true);
+            }
+
+            max_sizes[sample] = flow_size(trial, first);
+            meetups[sample] = max_sizes[sample] > 0 ? trial.get_earliest_meetup(start, end) : 0;
+            finished[sample] = 1;
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+
+    for (thread &t : pool) {
+        t.join();
+    }
+
+    BasicSimulationResult<Weight> result;
+    for (uint64_t sample = 0; sample < samples; sample++) {
+        if (!finished[sample]) {
+            continue;
+        }
+
+        result.max_sizes.push_back(max_sizes[sample]);
+        if (max_sizes[sample] > 0) {
+            result.meetups.push_back(meetups[sample]);
+        }
+    }
+
+    sort(result.max_sizes.begin(), result.max_sizes.end());
+    sort(result.meetups.begin(), result.meetups.end());
+
+    return result;
+}
+
+template struct BasicSimulationResult<uint32_t>;
+template struct BasicSimulationResult<uint64_t>;
+template class BasicCapacitySimulator<uint32_t, uint32_t>;
+template class BasicCapacitySimulator<uint64_t, uint64_t>;
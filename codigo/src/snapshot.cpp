@@ -0,0 +1,233 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "snapshot.h"
+#include "trace.h"
+
+using namespace std;
+
+/** @brief Marks a snapshot, the last byte being the version of the format */
+static const char SNAPSHOT_MAGIC[8] = { 'T', 'R', 'A', 'V', 'S', 'N', 'A', 2 };
+
+/** @brief The fixed start of a snapshot */
+struct SnapshotHeader {
+    char magic[8];
+
+    /** @brief sizeof(Index) and sizeof(Weight), which also tell apart a snapshot written in another byte order */
+    uint32_t index_bytes;
+    uint32_t weight_bytes;
+
+    uint32_t order;
+    uint32_t renumbered;
+    uint64_t nodes;
+    uint64_t edges;
+};
+
+/** @brief The profile of the graph, after the edges and the map of ids */
+struct SnapshotProfile {
+    /** @brief Whether the profile was gathered; the rest is only meaningful if so */
+    uint32_t valid;
+    uint32_t acyclic;
+    uint64_t depth;
+    uint64_t min_capacity;
+    uint64_t max_capacity;
+};
+
+/**
+ * @brief Reads and checks the header of a snapshot
+ *
+ * @return false if the stream doesn't start with a snapshot written on this machine
+ */
+static bool read_header(istream &in, SnapshotHeader &header) {
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+
+    bool known_widths = (header.index_bytes == 4 && header.weight_bytes == 4) || (header.index_bytes == 8 && header.weight_bytes == 8);
+    return memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 && known_widths
+        && header.order <= (uint32_t) NodeOrder::RCM;
+}
+
+/**
+ * @brief Writes the topology of a graph after the header
+ */
+template <class Index, class Weight>
+static void write_graph(ostream &out, const BasicGraph<Index, Weight> &graph) {
+    auto topology = graph.get_topology();
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.index_bytes = sizeof(Index);
+    header.weight_bytes = sizeof(Weight);
+    header.order = (uint32_t) topology->order;
+    header.renumbered = !topology->to_external.empty();
+    header.nodes = topology->n;
+    header.edges = topology->edges.size();
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    topology->edges.write(out);
+
+    if (header.renumbered) {
+        out.write(reinterpret_cast<const char *>(topology->to_external.data()), topology->to_external.size() * sizeof(Index));
+    }
+
+    // Gathering the profile walks the graph in topological order, which costs about as much as the rest of a
+    // load, so it's saved along with the order
+    const GraphProfile &profile = topology->profile;
+    SnapshotProfile saved = { profile.valid, profile.acyclic, profile.depth, profile.min_capacity, profile.max_capacity };
+    out.write(reinterpret_cast<const char *>(&saved), sizeof(saved));
+
+    if (profile.valid && profile.acyclic) {
+        out.write(reinterpret_cast<const char *>(topology->topological_order.data()), topology->n * sizeof(Index));
+        out.write(reinterpret_cast<const char *>(topology->topological_position.data()), (topology->n + 1) * sizeof(Index));
+    }
+}
+
+/**
+ * @brief Reads the topology of a graph after its header, rebuilding the adjacency lists and the map to internal ids
+ */
+template <class Index, class Weight>
+static BasicGraph<Index, Weight> read_graph(istream &in, const SnapshotHeader &header) {
+    using Topology = typename BasicGraph<Index, Weight>::Topology;
+
+    if (header.nodes >= numeric_limits<Index>::max()) {
+        throw invalid_argument("Corrupt snapshot");
+    }
+
+    auto topology = make_shared<Topology>();
+    topology->n = header.nodes;
+    topology->order = (NodeOrder) header.order;
+
+    if (!topology->edges.read(in, header.edges)) {
+        throw invalid_argument("Truncated snapshot");
+    }
+
+    const HugeVector<Index> &origins = topology->edges.get_origins();
+    const HugeVector<Index> &destinations = topology->edges.get_destinations();
+
+    // Sized first, so that each list is allocated once
+    vector<Index> outgoing(header.nodes + 1), incoming(header.nodes + 1);
+    for (size_t e = 0; e < header.edges; e++) {
+        if (origins[e] == 0 || destinations[e] == 0 || origins[e] > header.nodes || destinations[e] > header.nodes) {
+            throw invalid_argument("Corrupt snapshot");
+        }
+
+        outgoing[origins[e]]++;
+        incoming[destinations[e]]++;
+    }
+
+    topology->adjacency.resize(header.nodes + 1);
+    for (size_t i = 0; i <= header.nodes; i++) {
+        topology->adjacency[i].outgoing.reserve(outgoing[i]);
+        topology->adjacency[i].incoming.reserve(incoming[i]);
+    }
+
+    for (size_t e = 0; e < header.edges; e++) {
+        topology->adjacency[origins[e]].outgoing.push_back(e);
+        topology->adjacency[destinations[e]].incoming.push_back(e);
+    }
+
+    if (header.renumbered) {
+        topology->to_external.resize(header.nodes + 1);
+        if (!in.read(reinterpret_cast<char *>(topology->to_external.data()), (header.nodes + 1) * sizeof(Index))) {
+            throw invalid_argument("Truncated snapshot");
+        }
+
+        topology->to_internal.resize(header.nodes + 1);
+        for (size_t i = 0; i <= header.nodes; i++) {
+            if (topology->to_external[i] > header.nodes) {
+                throw invalid_argument("Corrupt snapshot");
+            }
+
+            topology->to_internal[topology->to_external[i]] = i;
+        }
+    }
+
+    SnapshotProfile saved;
+    if (!in.read(reinterpret_cast<char *>(&saved), sizeof(saved))) {
+        throw invalid_argument("Truncated snapshot");
+    }
+
+    if (saved.valid && saved.acyclic) {
+        topology->topological_order.resize(header.nodes);
+        topology->topological_position.resize(header.nodes + 1);
+
+        if (!in.read(reinterpret_cast<char *>(topology->topological_order.data()), header.nodes * sizeof(Index))
+            || !in.read(reinterpret_cast<char *>(topology->topological_position.data()), (header.nodes + 1) * sizeof(Index))) {
+            throw invalid_argument("Truncated snapshot");
+        }
+
+        for (size_t i = 0; i < header.nodes; i++) {
+            Index node = topology->topological_order[i];
+            if (node == 0 || node > header.nodes || topology->topological_position[node] != i) {
+                throw invalid_argument("Corrupt snapshot");
+            }
+        }
+    }
+
+    // Otherwise the graph gathers it again
+    if (saved.valid) {
+        GraphProfile &profile = topology->profile;
+        profile.valid = true;
+        profile.nodes = header.nodes;
+        profile.edges = header.edges;
+        profile.acyclic = saved.acyclic;
+        profile.depth = saved.depth;
+        profile.min_capacity = saved.min_capacity;
+        profile.max_capacity = saved.max_capacity;
+    }
+
+    return BasicGraph<Index, Weight>(move(topology));
+}
+
+bool read_snapshot_info(const string &path, SnapshotInfo &info) {
+    ifstream in(path, ios::binary);
+
+    SnapshotHeader header;
+    if (!read_header(in, header)) {
+        return false;
+    }
+
+    info = { header.index_bytes == 8, (NodeOrder) header.order, header.nodes, header.edges };
+    return true;
+}
+
+void save_snapshot(const AnyGraph &graph, const string &path) {
+    TRACE_SPAN("save snapshot");
+
+    // Readers never see half a snapshot: it's written aside and renamed over the old one
+    string partial = path + ".partial";
+    {
+        ofstream out(partial, ios::binary | ios::trunc);
+        visit([&](const auto &graph) { write_graph(out, graph); }, graph);
+
+        if (!out.flush()) {
+            throw runtime_error("Couldn't write " + partial);
+        }
+    }
+
+    filesystem::rename(partial, path);
+}
+
+AnyGraph load_snapshot(const string &path) {
+    TRACE_SPAN("load snapshot");
+
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        throw invalid_argument("Couldn't open given file");
+    }
+
+    SnapshotHeader header;
+    if (!read_header(in, header)) {
+        throw invalid_argument("Not a snapshot written on this machine");
+    }
+
+    if (header.index_bytes == 8) {
+        return read_graph<uint64_t, uint64_t>(in, header);
+    }
+
+    return read_graph<uint32_t, uint32_t>(in, header);
+}
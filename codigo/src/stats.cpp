@@ -0,0 +1,65 @@
+#include <chrono>
+#include <ostream>
+#include "stats.h"
+
+#ifdef TRAVEL_STATS
+#include "alloc_counter.h"
+#endif
+
+using namespace std;
+
+void QueryStats::print(ostream &out) const {
+    out << "Nodes settled: " << nodes_settled << ", edges relaxed: " << edges_relaxed
+        << ", heap inserts/increases/pops: " << heap_inserts << "/" << heap_increase_keys << "/" << heap_pops
+        << ", BFS passes: " << bfs_passes << ", augmentations: " << augmentations
+        << ", allocations: " << allocations << " (" << bytes_allocated << " bytes)"
+        << ", time: " << milliseconds << " ms\n";
+}
+
+void QueryStats::print_json(ostream &out) const {
+    out << "{\"nodes_settled\": " << nodes_settled << ", \"edges_relaxed\": " << edges_relaxed
+        << ", \"heap_inserts\": " << heap_inserts << ", \"heap_increase_keys\": " << heap_increase_keys
+        << ", \"heap_pops\": " << heap_pops << ", \"bfs_passes\": " << bfs_passes
+        << ", \"augmentations\": " << augmentations << ", \"allocations\": " << allocations
+        << ", \"bytes_allocated\": " << bytes_allocated << ", \"milliseconds\": " << milliseconds << "}\n";
+}
+
+#ifdef TRAVEL_STATS
+
+static thread_local chrono::steady_clock::time_point query_start;
+static thread_local AllocationStats allocations_at_start;
+
+bool stats_enabled() {
+    return true;
+}
+
+void start_query_stats() {
+    query_stats() = QueryStats();
+    allocations_at_start = allocation_stats();
+    query_start = chrono::steady_clock::now();
+}
+
+QueryStats finish_query_stats() {
+    QueryStats stats = query_stats();
+    AllocationStats allocations = allocation_stats();
+
+    stats.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - query_start).count();
+    stats.allocations = allocations.count - allocations_at_start.count;
+    stats.bytes_allocated = allocations.bytes - allocations_at_start.bytes;
+
+    return stats;
+}
+
+#else
+
+bool stats_enabled() {
+    return false;
+}
+
+void start_query_stats() {}
+
+QueryStats finish_query_stats() {
+    return QueryStats();
+}
+
+#endif
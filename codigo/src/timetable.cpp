@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include "timetable.h"
+
+using namespace std;
+
+template <class Index, class Weight>
+BasicTimetable<Index, Weight>::BasicTimetable(const BasicGraph<Index, Weight> &graph) : n(graph.size()) {
+    for (Index e = 0; e < graph.edge_count(); e++) {
+        const auto &edge = graph.get_edge(e);
+        if (!edge.is_active()) {
+            continue;
+        }
+
+        Weight arrival = edge.get_departure() + edge.get_duration();
+        // Connections use the ids of the dataset, so journeys need no translation
+        connections.push_back({ edge.get_departure(), arrival, graph.to_external_id(edge.get_origin()),
+                                graph.to_external_id(edge.get_destination()), edge.get_capacity() });
+    }
+
+    stable_sort(connections.begin(), connections.end(), [](const Connection &c1, const Connection &c2) {
+        return tie(c1.departure, c1.arrival) < tie(c2.departure, c2.arrival);
+    });
+}
+
+template <class Index, class Weight>
+const vector<BasicConnection<Index, Weight>> &BasicTimetable<Index, Weight>::get_connections() const {
+    return connections;
+}
+
+template <class Index, class Weight>
+size_t BasicTimetable<Index, Weight>::first_departure(Weight time) const {
+    auto it = lower_bound(connections.begin(), connections.end(), time, [](const Connection &c, Weight time) {
+        return c.departure < time;
+    });
+
+    return it - connections.begin();
+}
+
+template <class Index, class Weight>
+vector<BasicConnection<Index, Weight>> BasicTimetable<Index, Weight>::get_legs(size_t last) const {
+    vector<Connection> legs;
+    for (size_t i = last; i < connections.size(); i = previous[i]) {
+        legs.push_back(connections[i]);
+    }
+
+    reverse(legs.begin(), legs.end());
+    return legs;
+}
+
+template <class Index, class Weight>
+BasicJourney<Index, Weight> BasicTimetable<Index, Weight>::get_earliest_arrival(Index start, Index end, Weight time) {
+    const Index none = connections.size();
+
+    best.assign(n + 1, numeric_limits<Weight>::max());
+    reached_by.assign(n + 1, none);
+    previous.resize(connections.size());
+
+    best[start] = time;
+
+    for (size_t i = first_departure(time); i < connections.size(); i++) {
+        const Connection &c = connections[i];
+
+        // Every connection from here on arrives after the destination has been reached
+        if (c.departure >= best[end]) {
+            break;
+        }
+
+        if (best[c.origin] <= c.departure && c.arrival < best[c.destination]) {
+            best[c.destination] = c.arrival;
+            reached_by[c.destination] = i;
+            previous[i] = reached_by[c.origin];
+        }
+    }
+
+    Journey journey{ {}, 0, 0 };
+    if (start == end) {
+        return { {}, numeric_limits<Weight>::max(), time };
+    } else if (reached_by[end] == none) {
+        return journey;
+    }
+
+    journey.legs = get_legs(reached_by[end]);
+    journey.capacity = numeric_limits<Weight>::max();
+    for (const Connection &leg : journey.legs) {
+        journey.capacity = min(journey.capacity, leg.capacity);
+    }
+    journey.arrival = best[end];
+
+    return journey;
+}
+
+template <class Index, class Weight>
+BasicJourney<Index, Weight> BasicTimetable<Index, Weight>::get_max_capacity_by_deadline(Index start, Index end, Weight time, Weight deadline) {
+    const Index none = connections.size();
+
+    best.assign(n + 1, 0);
+    reached_by.assign(n + 1, none);
+    previous.resize(connections.size());
+
+    if (start == end) {
+        return { {}, numeric_limits<Weight>::max(), time };
+    }
+
+    best[start] = numeric_limits<Weight>::max();
+
+    // Arrivals not yet usable: arrival, capacity and connection
+    priority_queue<tuple<Weight, Weight, Index>, vector<tuple<Weight, Weight, Index>>, greater<>> pending;
+
+    Journey journey{ {}, 0, 0 };
+    Index last = none;
+
+    for (size_t i = first_departure(time); i < connections.size(); i++) {
+        const Connection &c = connections[i];
+        if (c.departure > deadline) {
+            break;
+        }
+
+        while (!pending.empty() && get<0>(pending.top()) <= c.departure) {
+            auto [arrival, capacity, p] = pending.top(); pending.pop();
+
+            Index dest = connections[p].destination;
+            if (capacity > best[dest]) {
+                best[dest] = capacity;
+                reached_by[dest] = p;
+            }
+        }
+
+        Weight capacity = min(best[c.origin], c.capacity);
+        if (c.arrival > deadline || capacity == 0 || c.destination == start) {
+            continue;
+        }
+
+        if (c.destination == end) {
+            if (capacity > journey.capacity || (capacity == journey.capacity && c.arrival < journey.arrival)) {
+                previous[i] = reached_by[c.origin];
+                journey.capacity = capacity;
+                journey.arrival = c.arrival;
+                last = i;
+            }
+        } else if (capacity > best[c.destination]) {
+            previous[i] = reached_by[c.origin];
+            pending.push({ c.arrival, capacity, i });
+        }
+    }
+
+    if (last != none) {
+        journey.legs = get_legs(last);
+    }
+
+    return journey;
+}
+
+template class BasicTimetable<uint32_t, uint32_t>;
+template class BasicTimetable<uint64_t, uint64_t>;
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <iomanip>
+#include "trace.h"
+
+using namespace std;
+
+static atomic<bool> tracing{false};
+static const chrono::steady_clock::time_point trace_origin = chrono::steady_clock::now();
+
+/** @brief Every ring, kept alive after their threads end so that their spans can still be exported */
+static mutex rings_mutex;
+static vector<shared_ptr<TraceRing>> rings;
+
+/** @brief The histograms of each scenario, the total under an empty phase name */
+static mutex histograms_mutex;
+static map<pair<string, string>, LatencyHistogram> histograms;
+
+/**
+ * @brief The histograms of the phases a thread ran in its current query, not yet added to the shared ones
+ *
+ * Spans record here without locking or allocating, once each phase was seen. They're merged when the scenario
+ * changes, when the histograms are written and when the thread exits.
+ */
+struct LocalHistograms {
+    string scenario = "(outside scenarios)";
+
+    /** @brief Keyed by the names spans are given, which are few, so they're searched in order */
+    vector<pair<const char *, LatencyHistogram>> phases;
+
+    /** @brief Adds the phases to the shared histograms, under the scenario, and empties them */
+    void merge();
+
+    ~LocalHistograms();
+};
+
+void LocalHistograms::merge() {
+    lock_guard<mutex> lock(histograms_mutex);
+
+    for (auto &[phase, histogram] : phases) {
+        if (histogram.count() > 0) {
+            histograms[{ scenario, phase }].merge(histogram);
+            histogram.clear();
+        }
+    }
+}
+
+LocalHistograms::~LocalHistograms() {
+    merge();
+}
+
+/** @brief The state of the current query of each thread */
+static thread_local LocalHistograms local_histograms;
+static thread_local uint64_t query_time = 0;
+static thread_local unsigned span_depth = 0;
+
+/**
+ * @brief Gets the nanoseconds since the program started
+ *
+ * @return The nanoseconds
+ */
+static uint64_t now() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - trace_origin).count();
+}
+
+/**
+ * @brief Gets the calling thread's ring, registering it on first use
+ *
+ * @return The ring
+ */
+static TraceRing &thread_ring() {
+    thread_local shared_ptr<TraceRing> ring;
+
+    if (!ring) {
+        lock_guard<mutex> lock(rings_mutex);
+        ring = make_shared<TraceRing>(rings.size() + 1);
+        rings.push_back(ring);
+    }
+
+    return *ring;
+}
+
+TraceRing::TraceRing(uint32_t thread) : thread(thread) {}
+
+void TraceRing::push(const TraceEvent &event) {
+    uint64_t position = head.load(memory_order_relaxed);
+    events[position % CAPACITY] = event;
+    head.store(position + 1, memory_order_release);
+}
+
+vector<TraceEvent> TraceRing::snapshot() const {
+    uint64_t end = head.load(memory_order_acquire);
+    uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+
+    vector<TraceEvent> copy;
+    for (uint64_t position = begin; position < end; position++) {
+        copy.push_back(events[position % CAPACITY]);
+    }
+
+    return copy;
+}
+
+uint32_t TraceRing::get_thread() const {
+    return thread;
+}
+
+size_t LatencyHistogram::bucket_of(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    unsigned exponent = 63 - __builtin_clzll(value);
+    uint64_t sub = (value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::value_of(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    unsigned exponent = bucket / SUB_BUCKETS - 1 + SUB_BITS;
+    uint64_t sub = bucket % SUB_BUCKETS;
+
+    // The middle of the bucket
+    uint64_t low = (SUB_BUCKETS + sub) << (exponent - SUB_BITS);
+    return low + ((uint64_t(1) << (exponent - SUB_BITS)) >> 1);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    size_t bucket = bucket_of(nanoseconds);
+    if (bucket >= counts.size()) {
+        counts.resize(bucket + 1);
+    }
+
+    counts[bucket]++;
+    total++;
+    maximum = std::max(maximum, nanoseconds);
+    sum += nanoseconds;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t) (p / 100 * total + 0.5));
+    uint64_t seen = 0;
+
+    for (size_t bucket = 0; bucket < counts.size(); bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(value_of(bucket), maximum);
+        }
+    }
+
+    return maximum;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    if (other.counts.size() > counts.size()) {
+        counts.resize(other.counts.size());
+    }
+
+    for (size_t bucket = 0; bucket < other.counts.size(); bucket++) {
+        counts[bucket] += other.counts[bucket];
+    }
+
+    total += other.total;
+    maximum = std::max(maximum, other.maximum);
+    sum += other.sum;
+}
+
+void LatencyHistogram::clear() {
+    fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    maximum = 0;
+    sum = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return maximum;
+}
+
+double LatencyHistogram::mean() const {
+    return total == 0 ? 0 : sum / total;
+}
+
+TraceSpan::TraceSpan(const char *name) : name(name), start(0), recording(tracing.load(memory_order_relaxed)) {
+    if (recording) {
+        start = now();
+        span_depth++;
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (!recording) {
+        return;
+    }
+
+    uint64_t duration = now() - start;
+    thread_ring().push({ name, start, duration });
+
+    if (--span_depth == 0) {
+        query_time += duration;
+    }
+
+    // Names are string literals, so the same phase almost always has the same pointer
+    auto &phases = local_histograms.phases;
+    auto phase = find_if(phases.begin(), phases.end(), [this](const auto &phase) {
+        return phase.first == name || strcmp(phase.first, name) == 0;
+    });
+
+    if (phase == phases.end()) {
+        phases.push_back({ name, LatencyHistogram() });
+        phase = phases.end() - 1;
+    }
+
+    phase->second.record(duration);
+}
+
+void set_tracing(bool enabled) {
+    tracing.store(enabled, memory_order_relaxed);
+}
+
+bool tracing_enabled() {
+    return tracing.load(memory_order_relaxed);
+}
+
+void begin_traced_query(const string &scenario) {
+    local_histograms.merge();
+    local_histograms.scenario = scenario;
+    query_time = 0;
+}
+
+void end_traced_query() {
+    local_histograms.merge();
+
+    if (tracing_enabled()) {
+        lock_guard<mutex> lock(histograms_mutex);
+        histograms[{ local_histograms.scenario, "" }].record(query_time);
+    }
+
+    local_histograms.scenario = "(outside scenarios)";
+    query_time = 0;
+}
+
+void write_chrome_trace(ostream &out) {
+    vector<shared_ptr<TraceRing>> copy;
+    {
+        lock_guard<mutex> lock(rings_mutex);
+        copy = rings;
+    }
+
+    out << "{\"traceEvents\": [";
+
+    bool first = true;
+    for (const shared_ptr<TraceRing> &ring : copy) {
+        for (const TraceEvent &event : ring->snapshot()) {
+            out << (first ? "\n" : ",\n") << "  {\"name\": \"" << event.name << "\", \"cat\": \"travel\", \"ph\": \"X\""
+                << ", \"ts\": " << event.start / 1000 << "." << setw(3) << setfill('0') << event.start % 1000
+                << ", \"dur\": " << event.duration / 1000 << "." << setw(3) << setfill('0') << event.duration % 1000
+                << setfill(' ') << ", \"pid\": 1, \"tid\": " << ring->get_thread() << "}";
+            first = false;
+        }
+    }
+
+    out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+void write_latency_histograms(ostream &out) {
+    local_histograms.merge();
+    lock_guard<mutex> lock(histograms_mutex);
+
+    out << left << setw(60) << "scenario / phase" << right << setw(8) << "count" << setw(12) << "mean us"
+        << setw(12) << "p50 us" << setw(12) << "p90 us" << setw(12) << "p99 us" << setw(12) << "p99.9 us"
+        << setw(12) << "max us" << "\n";
+
+    out << fixed << setprecision(1);
+    const string *last_scenario = nullptr;
+
+    for (const auto &[key, histogram] : histograms) {
+        const auto &[scenario, phase] = key;
+
+        // Spans outside queries have no total, but still need their heading
+        if (!phase.empty() && (last_scenario == nullptr || *last_scenario != scenario)) {
+            out << scenario << "\n";
+        }
+        last_scenario = &scenario;
+
+        string label = phase.empty() ? scenario : "    " + phase;
+
+        out << left << setw(60) << label.substr(0, 59) << right << setw(8) << histogram.count()
+            << setw(12) << histogram.mean() / 1000 << setw(12) << histogram.percentile(50) / 1000.0
+            << setw(12) << histogram.percentile(90) / 1000.0 << setw(12) << histogram.percentile(99) / 1000.0
+            << setw(12) << histogram.percentile(99.9) / 1000.0 << setw(12) << histogram.max() / 1000.0 << "\n";
+    }
+
+    out << defaultfloat;
+}
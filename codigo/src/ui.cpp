@@ -1,6 +1,12 @@
 #include "ui.h"
 #include "entities/graph.h"
 #include "dataset.h"
+#include "planner.h"
+#include "simulator.h"
+#include "timetable.h"
+#include "trace.h"
+#include "engines.h"
+#include "result_writer.h"
 
 #include <iostream>
 #include <string>
@@ -11,34 +17,142 @@
 #include <iomanip>
 #include <regex>
 #include <string>
+#include <variant>
 
 #include <stdio.h>
 #include <stdlib.h>
 
 using namespace std;
 
-UI::UI(bool sort) : sort(sort) {
-    bool is_running = true;
+/**
+ * @brief Writes a flow and the dimension of the group it carries
+ *
+ * @param writer The writer of the result
+ * @param flow_path The edges with flow, already ordered
+ * @param start The starting point, whose outgoing flow is the dimension of the group
+ * @param dimension How the dimension is written in text
+ */
+template <class FlowPath>
+static void write_flow(ResultWriter &writer, const FlowPath &flow_path, unsigned long start, const char *dimension) {
+    unsigned long max_capacity = 0;
+
+    writer.text("\nFormat: [ origin -> destination / flow ]\n\n");
+    writer.begin_table("flow", { "origin", "destination", "flow" }, "[ {} -> {} / {} ]\n");
+    for (const auto &[origin, destination, flow] : flow_path) {
+        if (origin == start)
+            max_capacity += flow;
+
+        writer.row({ origin, destination, flow });
+    }
+    writer.end_table();
 
-    string filename = choose_file();
-    File file(filename);
-    int n = file.get_header()[0];
+    writer.value("dimension", dimension, max_capacity);
+}
 
-    Graph graph{n}; 
+UI::UI(OutputFormat format, StatsOutput stats, const string &output_file, NodeOrder order,
+       const vector<pair<string, string>> &named_datasets, size_t memory_budget, const string &snapshot_dir, bool compress,
+       chrono::milliseconds query_timeout, bool explain)
+    : datasets(order, memory_budget, snapshot_dir, compress), format(format), stats(stats), order(order), query_timeout(query_timeout),
+      explain(explain) {
+    if (!output_file.empty()) {
+        output.open(output_file);
+        if (!output.is_open()) {
+            throw runtime_error("Couldn't open " + output_file);
+        }
+    }
 
-    for (Edge &edge : Edge::from_file(file)) {
-        graph.add_edge(edge);
+    for (const auto &[name, path] : named_datasets) {
+        datasets.add(name, path);
     }
 
-    this->graph = graph;
+    if (!named_datasets.empty()) {
+        load(named_datasets.front().first);
+        return;
+    }
+
+    string file = choose_file();
+    datasets.add(file, file);
+    load(file);
 }
 
-void UI::start() {
-    Menu scenario_choice = get_scenario_menu();
+ostream &UI::results() {
+    return output.is_open() ? output : cout;
+}
+
+void UI::load(const string &name) {
+    TRACE_SPAN("load");
+
+    versions.publish(datasets.get(name), name);
+    refresh();
+}
+
+void UI::switch_to(const string &name) {
+    // Queries keep running on the current dataset while the new one is loaded
+    bool started = versions.build_in_background([this, name]() { return datasets.get(name); }, name);
+
+    if (started) {
+        cout << "\nSwitching to " << name << " in the background, the current dataset is used until it's ready\n";
+    } else {
+        cout << "\nAnother dataset is still loading, try again once it's ready\n";
+    }
+}
+
+string UI::choose_dataset() {
+    vector<DatasetInfo> list = datasets.list();
+
+    cout << "\nDatasets (" << fixed << setprecision(1) << datasets.get_resident_bytes() / 1048576.0 << " MiB resident";
+    if (datasets.get_budget() > 0) {
+        cout << " of " << datasets.get_budget() / 1048576.0 << " MiB";
+    }
+    cout << "):\n";
+
+    for (size_t i = 0; i < list.size(); i++) {
+        cout << "[" << i + 1 << "] " << list[i].name << " (" << list[i].path << ")";
+        if (list[i].resident) {
+            cout << ", resident, " << list[i].bytes / 1048576.0 << " MiB";
+        }
+        cout << "\n";
+    }
+    cout << defaultfloat;
+
+    unsigned long choice = read_value<unsigned long>("Choose a dataset: ", "Invalid dataset", [&list](const unsigned long &choice) {
+        return choice >= 1 && choice <= list.size();
+    });
+
+    return list[choice - 1].name;
+}
+
+void UI::refresh() {
+    string error = versions.take_error();
+    if (!error.empty()) {
+        cout << "\nCouldn't load " << error << ", so the current dataset is kept\n";
+    }
 
+    shared_ptr<const GraphVersion> latest = versions.acquire();
+    if (latest == version) {
+        return;
+    }
+
+    // The flows left by scenario 2.1 or 2.3 belong to the old dataset
+    bool replacing = version != nullptr;
+    this->version = latest;
+    this->graph = latest->graph;
+    this->timetable = monostate();
+    this->scenario_two_executed = false;
+
+    if (replacing) {
+        cout << "\nNow using " << latest->name << "\n";
+    }
+}
+
+void UI::start() {
     while (is_running) {
+        refresh();
 
-        MenuBlock special_block;    
+        // Rebuilt each time, as the options depend on the datasets registered so far
+        Menu scenario_choice = get_scenario_menu();
+
+        MenuBlock special_block;
         special_block.add_option("Exit", [this]() { is_running = false; });
 
         scenario_choice.set_special_block(special_block);
@@ -62,18 +176,73 @@ string UI::choose_file() {
 
 std::pair<unsigned long, unsigned long> UI::choose_starting_and_ending_nodes() {
     std::pair<unsigned long, unsigned long> pair;
+    unsigned long size = visit([](auto &graph) -> unsigned long { return graph.size(); }, this->graph);
 
-    pair.first = read_value<unsigned long>("Choose a starting node: ", "Invalid node", [this](const unsigned long &start) {
-        return start >= 1 && start <= this->graph.size();
+    pair.first = read_value<unsigned long>("Choose a starting node: ", "Invalid node", [size](const unsigned long &start) {
+        return start >= 1 && start <= size;
     });
 
-    pair.second = read_value<unsigned long>("Choose an ending node: ", "Invalid node", [this](const unsigned long &end) {
-        return end >= 1 && end <= this->graph.size();
+    pair.second = read_value<unsigned long>("Choose an ending node: ", "Invalid node", [size](const unsigned long &end) {
+        return end >= 1 && end <= size;
     });
 
     return pair;
 }
 
+MenuBlock UI::instrument(const MenuBlock &block) {
+    bool measured = stats != StatsOutput::NONE || tracing_enabled() || explain;
+
+    MenuBlock instrumented;
+    for (const MenuOption &option : block.get_options()) {
+        std::function<void()> callback = option.second;
+
+        // Histograms are kept per scenario, named by the tag at the start of the option
+        string scenario = option.first.substr(0, option.first.find(']') + 1);
+
+        instrumented.add_option(option.first, [this, callback, scenario, measured]() {
+            // The timeout only starts with the first search, so reading the query's input doesn't count
+            query_token = CancellationToken(query_timeout);
+            visit([this](auto &graph) { graph.set_cancellation(query_token); }, this->graph);
+            CancelOnInterrupt interrupt(query_token);
+
+            if (measured) {
+                start_query_stats();
+                start_engine_report();
+                begin_traced_query(scenario);
+            }
+
+            callback();
+
+            if (measured) {
+                end_traced_query();
+                QueryStats query = finish_query_stats();
+
+                if (this->stats == StatsOutput::JSON) {
+                    query.print_json(cerr);
+                } else if (this->stats == StatsOutput::TEXT) {
+                    cerr << "Statistics: ";
+                    query.print(cerr);
+                }
+
+                // The counters are left out of the explanation when --stats already printed them, or they're all 0
+                if (this->explain) {
+                    engine_report().print(cerr);
+                    if (this->stats == StatsOutput::NONE && stats_enabled()) {
+                        cerr << "Cost: ";
+                        query.print(cerr);
+                    }
+                }
+            }
+
+            if (query_token.is_cancelled()) {
+                cerr << "The query was stopped early, so its result is only the best found until then" << endl;
+            }
+        });
+    }
+
+    return instrumented;
+}
+
 Menu UI::get_separation_menu() {
     Menu scenario("Choose one of the following scenarios:");
 
@@ -87,139 +256,229 @@ Menu UI::get_separation_menu() {
             return start > 0;
         });
 
-        list<tuple<unsigned long, unsigned long, unsigned long>> lst = graph.get_path_for_group_of_size(start_end_nodes.first, start_end_nodes.second, size);
+        visit([&](auto &graph) {
+            auto lst = graph.get_path_for_group_of_size(start_end_nodes.first, start_end_nodes.second, size);
+            TRACE_SPAN("output");
 
-        if (sort) {
-            lst.sort([](tuple<unsigned long, unsigned long, unsigned long> t1, tuple<unsigned long, unsigned long, unsigned long> t2) {
-                auto [origin1, destination1, flow1] = t1;
-                auto [origin2, destination2, flow2] = t2;
+            ResultWriter writer(results(), format);
+            write_flow(writer, lst, start_end_nodes.first, "\nDimension of the group: {}\n\n");
+        }, this->graph);
+    });
 
-                if (origin1 == origin2) {
-                    if (destination1 == destination2) {
-                        return flow1 < flow2;
-                    }
-                    
-                    return destination1 < destination2;
-                }
-                
-                return origin1 < origin2;
+    if (scenario_two_executed) {
+        scenario_options.add_option("[Scenario 2.2] Correct a route, if needed, so that the size of the group can increase from a number of units given", [this]() {
+            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+            unsigned long increment = read_value<unsigned long>("Choose the increment value: ", "Invalid increment", [](const unsigned long &start) {
+                return start > 0;
             });
-        }
 
-        unsigned long max_capacity = 0;
+            visit([&](auto &graph) {
+                auto lst = graph.get_path_with_increment(start_end_nodes.first, start_end_nodes.second, increment);
+                TRACE_SPAN("output");
 
-        cout << "\nFormat: [ origin -> destination / flow ]\n\n";
-        for (auto it = lst.begin(); it != lst.end(); ++it) {
-            auto [origin, destination, flow] = *it;
-            if (origin == start_end_nodes.first)
-                max_capacity += flow;
+                ResultWriter writer(results(), format);
+                write_flow(writer, lst, start_end_nodes.first, "\nDimension of the group: {}\n\n");
+            }, this->graph);
+    });}
 
-            cout << "[ " << origin << " -> " << destination << " / " << flow << " ]" << endl;
-        }
+    scenario_options.add_option("[Scenario 2.3] Determine the maximum dimension of a group and a path", [this]() {
+        this->scenario_two_executed = true;
+
+        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+        visit([&](auto &graph) {
+            auto lst = graph.get_path_for_group_of_max_size(start_end_nodes.first, start_end_nodes.second);
+            TRACE_SPAN("output");
 
-        cout << "\nDimension of the group: " << max_capacity << endl << endl;
+            ResultWriter writer(results(), format);
+            write_flow(writer, lst, start_end_nodes.first, "\nMax dimension of the group: {}\n\n");
+        }, this->graph);
     });
 
     if (scenario_two_executed) {
-        scenario_options.add_option("[Scenario 2.2] Correct a route, if needed, so that the size of the group can increase from a number of units given", [this]() {
+            scenario_options.add_option("[Scenario 2.4] Determine when the group would meet again at the destination", [this]() {
             std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+            unsigned long earliest_meetup = visit([&](auto &graph) -> unsigned long {
+                return graph.get_earliest_meetup(start_end_nodes.first, start_end_nodes.second);
+            }, this->graph);
 
-            unsigned long increment = read_value<unsigned long>("Choose the increment value: ", "Invalid increment", [](const unsigned long &start) {
-                return start > 0;
-            });
+            ResultWriter writer(results(), format);
+            writer.value("earliest_meetup", "\nEarliest time at which a group of people would meetup again: {}\n\n", earliest_meetup);
+        });
 
-            list<tuple<unsigned long, unsigned long, unsigned long>> lst = graph.get_path_with_increment(start_end_nodes.first, start_end_nodes.second, increment);
+        scenario_options.add_option("[Scenario 2.5] Determine the maximum waiting time and the places where there would be elements that wait for that time, assuming that the elements that leave the same location depart from that location at the same time (and as soon as possible), ", [this]() {
+            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
 
-            if (sort) {
-                lst.sort([](tuple<unsigned long, unsigned long, unsigned long> t1, tuple<unsigned long, unsigned long, unsigned long> t2) {
-                    auto [origin1, destination1, flow1] = t1;
-                    auto [origin2, destination2, flow2] = t2;
+            visit([&](auto &graph) {
+                auto lst = graph.get_waiting_periods(start_end_nodes.first, start_end_nodes.second);
+                TRACE_SPAN("output");
 
-                    if (origin1 == origin2) {
-                        if (destination1 == destination2) {
-                            return flow1 < flow2;
-                        }
-                        
-                        return destination1 < destination2;
-                    }
-                    
-                    return origin1 < origin2;
-                });
-            }
+                ResultWriter writer(results(), format);
+                writer.text("\n");
+                writer.begin_table("waiting_periods", { "node", "duration" }, "[ node: {} ] (duration: {})\n");
+                for (const auto &[place, duration] : lst) {
+                    writer.row({ place, duration });
+                }
+                writer.end_table();
+                writer.text("\n");
+            }, this->graph);
 
-            unsigned long max_capacity = 0;
+        });
 
-            cout << "\nFormat: [ origin -> destination / flow ]\n\n";
-            for (auto it = lst.begin(); it != lst.end(); ++it) {
-                auto [origin, destination, flow] = *it;
-                if (origin == start_end_nodes.first)
-                    max_capacity += flow;
+        scenario_options.add_option("[Scenario 2.6] Determine the buses that limit the maximum dimension of the group", [this]() {
+            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
 
-                cout << "[ " << origin << " -> " << destination << " / " << flow << " ]" << endl;
-            }
+            visit([&](auto &graph) {
+                decltype(graph.get_min_cut(0, 0)) cut, critical;
+                graph.get_bottlenecks(start_end_nodes.first, start_end_nodes.second, cut, critical);
 
-            cout << "\nDimension of the group: " << max_capacity << endl << endl;
-    });}
+                ResultWriter writer(results(), format);
 
-    scenario_options.add_option("[Scenario 2.3] Determine the maximum dimension of a group and a path", [this]() {
-        this->scenario_two_executed = true;
+                writer.text("\nMinimum cut: [ origin -> destination / capacity ]\n\n");
+                writer.begin_table("min_cut", { "origin", "destination", "capacity" }, "[ {} -> {} / {} ]\n");
+                for (const auto &[origin, destination, capacity] : cut) {
+                    writer.row({ origin, destination, capacity });
+                }
+                writer.end_table();
 
-        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
-        list<tuple<unsigned long, unsigned long, unsigned long>> lst = graph.get_path_for_group_of_max_size(start_end_nodes.first, start_end_nodes.second);
+                writer.text("\nBuses where extra seats raise the maximum dimension: [ origin -> destination / up to ]\n\n");
+                writer.begin_table("critical_edges", { "origin", "destination", "gain" }, "[ {} -> {} / {} ]\n");
+                for (const auto &[origin, destination, gain] : critical) {
+                    writer.row({ origin, destination, gain });
+                }
+                writer.end_table();
+                writer.text("\n");
+            }, this->graph);
+    });}
 
-        if (sort) {
-            lst.sort([](tuple<unsigned long, unsigned long, unsigned long> t1, tuple<unsigned long, unsigned long, unsigned long> t2) {
-                auto [origin1, destination1, flow1] = t1;
-                auto [origin2, destination2, flow2] = t2;
+    scenario_options.add_option("[Scenario 2.7] Determine routes for several groups that share the same buses", [this]() {
+        unsigned long count = read_value<unsigned long>("Choose the number of groups: ", "Invalid number of groups", [](const unsigned long &count) {
+            return count > 0;
+        });
 
-                if (origin1 == origin2) {
-                    if (destination1 == destination2) {
-                        return flow1 < flow2;
-                    }
-                        
-                    return destination1 < destination2;
-                }
-                    
-                return origin1 < origin2;
+        vector<Group> groups;
+        for (unsigned long i = 1; i <= count; i++) {
+            cout << "\nGroup " << i << ":\n";
+            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+            unsigned long size = read_value<unsigned long>("Choose the group size: ", "Invalid size", [](const unsigned long &size) {
+                return size > 0;
             });
+
+            groups.push_back({ start_end_nodes.first, start_end_nodes.second, size });
         }
 
-        unsigned long max_capacity = 0;
+        visit([&](auto &graph) {
+            BasicGroupPlanner planner(graph);
+            for (const Group &group : groups) {
+                planner.add_group(group);
+            }
 
-        cout << "\nFormat: [ origin -> destination / flow ]\n\n";
-        for (auto it = lst.begin(); it != lst.end(); ++it) {
-            auto [origin, destination, flow] = *it;
-            if (origin == start_end_nodes.first)
-                max_capacity += flow;
+            auto routes = planner.plan_groups();
+            TRACE_SPAN("output");
 
-            cout << "[ " << origin << " -> " << destination << " / " << flow << " ]" << endl;
-        }
+            ResultWriter writer(results(), format);
+
+            // In text, each group is introduced above its routes instead
+            writer.begin_table("groups", { "group", "start", "end", "routed", "size" }, "");
+            for (size_t i = 0; i < routes.size(); i++) {
+                const auto &route = routes[i];
+                writer.row({ i + 1, route.group.start, route.group.end, route.routed, route.group.size });
+            }
+            writer.end_table();
 
-        cout << "\nMax dimension of the group: " << max_capacity << endl << endl;
+            writer.text("\nFormat: [ origin -> destination / flow ]\n");
+            writer.begin_table("routes", { "origin", "destination", "flow", "group" }, "[ {} -> {} / {} ]\n");
+            for (size_t i = 0; i < routes.size(); i++) {
+                const auto &route = routes[i];
+
+                string heading = "\nGroup " + to_string(i + 1) + " (" + to_string(route.group.start) + " -> " + to_string(route.group.end) + "): "
+                    + to_string(route.routed) + " of " + to_string(route.group.size) + " people routed\n";
+                writer.text(heading.c_str());
+
+                for (const auto &[origin, destination, flow] : route.flow_path) {
+                    writer.row({ origin, destination, flow, i + 1 });
+                }
+            }
+            writer.end_table();
+
+            writer.text("\nResidual capacity of the buses used: [ origin -> destination / free seats ]\n\n");
+            writer.begin_table("residual_capacity", { "origin", "destination", "free_seats" }, "[ {} -> {} / {} ]\n");
+            for (const auto &[origin, destination, residual] : planner.get_residual_capacity()) {
+                writer.row({ origin, destination, residual });
+            }
+            writer.end_table();
+            writer.text("\n");
+        }, this->graph);
     });
 
-    if (scenario_two_executed) {
-            scenario_options.add_option("[Scenario 2.4] Determine when the group would meet again at the destination", [this]() {
-            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
-            unsigned long earliest_meetup = graph.get_earliest_meetup(start_end_nodes.first, start_end_nodes.second);
+    scenario_options.add_option("[Scenario 2.8] Simulate buses running under capacity or being cancelled", [this]() {
+        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
 
-            cout << "\nEarliest time at which a group of people would meetup again: " << earliest_meetup << endl << endl;
+        CapacityModel model;
+        model.cancel_probability = read_value<double>("Choose the probability of a bus being cancelled (0 to 1): ", "Invalid probability", [](const double &p) {
+            return p >= 0 && p <= 1;
         });
 
-        scenario_options.add_option("[Scenario 2.5] Determine the maximum waiting time and the places where there would be elements that wait for that time, assuming that the elements that leave the same location depart from that location at the same time (and as soon as possible), ", [this]() {
-            std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
-            std::list<std::pair<unsigned long, unsigned int>> lst = graph.get_waiting_periods(start_end_nodes.first, start_end_nodes.second);
+        unsigned long distribution = read_value<unsigned long>("Choose the distribution of the fill factor (1 - uniform, 2 - normal): ", "Invalid distribution", [](const unsigned long &d) {
+            return d == 1 || d == 2;
+        });
 
-            cout << endl;
-            for (auto it = lst.begin(); it != lst.end(); ++it) {
-                auto [place, duration] = *it;
-                cout << "[ node: " << place << " ] (duration: " << duration << ")" << endl;
+        if (distribution == 1) {
+            model.distribution = Perturbation::UNIFORM;
+            model.low = read_value<double>("Choose the minimum fill factor (0 to 1): ", "Invalid fill factor", [](const double &f) {
+                return f >= 0 && f <= 1;
+            });
+            model.high = 1;
+        } else {
+            model.distribution = Perturbation::NORMAL;
+            model.mean = read_value<double>("Choose the mean fill factor (0 to 1): ", "Invalid fill factor", [](const double &f) {
+                return f >= 0 && f <= 1;
+            });
+            model.deviation = read_value<double>("Choose the standard deviation of the fill factor: ", "Invalid deviation", [](const double &d) {
+                return d >= 0;
+            });
+        }
+
+        unsigned long samples = read_value<unsigned long>("Choose the number of samples: ", "Invalid number of samples", [](const unsigned long &samples) {
+            return samples > 0;
+        });
+
+        unsigned long seed = read_value<unsigned long>("Choose the seed: ", "Invalid seed", [](const unsigned long &) {
+            return true;
+        });
+
+        visit([&](auto &graph) {
+            BasicCapacitySimulator simulator(graph, model);
+            auto result = simulator.simulate(start_end_nodes.first, start_end_nodes.second, samples, seed, 0, query_token);
+            TRACE_SPAN("output");
+
+            using Result = decltype(result);
+            ResultWriter writer(results(), format);
+
+            writer.text("\nMaximum dimension of the group: ");
+            writer.decimal("max_size_mean", "mean {}", Result::mean(result.max_sizes));
+            writer.value("max_size_p5", " / p5 {}", Result::percentile(result.max_sizes, 5));
+            writer.value("max_size_p50", " / p50 {}", Result::percentile(result.max_sizes, 50));
+            writer.value("max_size_p95", " / p95 {}\n", Result::percentile(result.max_sizes, 95));
+
+            writer.value("travelling_samples", "Samples where the group can travel: {}", result.meetups.size());
+            writer.value("samples", " of {}\n", result.max_sizes.size());
+
+            if (!result.meetups.empty()) {
+                writer.text("Earliest meetup: ");
+                writer.decimal("meetup_mean", "mean {}", Result::mean(result.meetups));
+                writer.value("meetup_p5", " / p5 {}", Result::percentile(result.meetups, 5));
+                writer.value("meetup_p50", " / p50 {}", Result::percentile(result.meetups, 50));
+                writer.value("meetup_p95", " / p95 {}\n", Result::percentile(result.meetups, 95));
             }
-            cout << endl;
 
-    });}
+            writer.text("\n");
+        }, this->graph);
+    });
 
-    scenario.add_block(scenario_options);
+    scenario.add_block(instrument(scenario_options));
     return scenario;
 }
 
@@ -231,50 +490,173 @@ Menu UI::get_non_separation_menu() {
     scenario_options.add_option("[Scenario 1.1] Maximize the size of the group and indicate any routing", [this]() {
         std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
 
-        auto [lst, capacity, distance] = graph.get_max_capacity_path(start_end_nodes.first, start_end_nodes.second);
+        visit([&](auto &graph) {
+            auto [lst, capacity, distance] = graph.get_max_capacity_path(start_end_nodes.first, start_end_nodes.second);
+            TRACE_SPAN("output");
 
-        cout << endl << "Path: ";
-        for (auto it = lst.begin(); it != lst.end(); ++it) {
-            if (it == --lst.end())
-                cout << *it;
-            else
-                cout << *it << " -> ";
-        }
-        cout << "\nCapacity: " << capacity << endl << endl;
+            cout << endl << "Path: ";
+            for (auto it = lst.begin(); it != lst.end(); ++it) {
+                if (it == --lst.end())
+                    cout << *it;
+                else
+                    cout << *it << " -> ";
+            }
+            cout << "\nCapacity: " << capacity << endl << endl;
+        }, this->graph);
     });
 
     scenario_options.add_option("[Scenario 1.2] Find pareto-optimal paths", [this]() {
         std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
-       
-        auto [lst, cap, dist] = this->graph.get_pareto_optimal_path(start_end_nodes.first, start_end_nodes.second, true);
-
-        cout << endl << "Path: ";
-        for (auto it = lst.begin(); it != lst.end(); ++it) {
-            if (it == --lst.end())
-                cout << *it;
-            else
-                cout << *it << " -> ";
-        }
-        cout << "\nCapacity: " << cap << "\nDistance: " << dist << endl;
-
-        auto [lst2, cap2, dist2] = graph.get_pareto_optimal_path(start_end_nodes.first, start_end_nodes.second, false);
-        
-        if (cap != cap2 && dist != dist2) {    
-            cout << "------" << endl << "Path: ";
-            for (auto it = lst2.begin(); it != lst2.end(); ++it) {
-                
-                if (it == --lst2.end())
+
+        visit([&](auto &graph) {
+            auto [lst, cap, dist] = graph.get_pareto_optimal_path(start_end_nodes.first, start_end_nodes.second, PathOrder::CAPACITY_FIRST);
+
+            cout << endl << "Path: ";
+            for (auto it = lst.begin(); it != lst.end(); ++it) {
+                if (it == --lst.end())
                     cout << *it;
                 else
                     cout << *it << " -> ";
             }
-            cout << "\nCapacity: " << cap2 << "\nDistance: " << dist2 << endl;
-        }
+            cout << "\nCapacity: " << cap << "\nDistance: " << dist << endl;
+
+            auto [lst2, cap2, dist2] = graph.get_pareto_optimal_path(start_end_nodes.first, start_end_nodes.second, PathOrder::HOPS_FIRST);
+
+            if (cap != cap2 && dist != dist2) {
+                cout << "------" << endl << "Path: ";
+                for (auto it = lst2.begin(); it != lst2.end(); ++it) {
+
+                    if (it == --lst2.end())
+                        cout << *it;
+                    else
+                        cout << *it << " -> ";
+                }
+                cout << "\nCapacity: " << cap2 << "\nDistance: " << dist2 << endl;
+            }
 
-        cout << endl;
+            cout << endl;
+        }, this->graph);
     });
 
-    scenario.add_block(scenario_options);
+    scenario_options.add_option("[Scenario 1.3] Find an alternative route for each bus of the route that may be cancelled", [this]() {
+        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+        visit([&](auto &graph) {
+            auto [lst, capacity, distance] = graph.get_max_capacity_path(start_end_nodes.first, start_end_nodes.second);
+
+            cout << endl << "Path: ";
+            for (auto it = lst.begin(); it != lst.end(); ++it) {
+                if (it == --lst.end())
+                    cout << *it;
+                else
+                    cout << *it << " -> ";
+            }
+            cout << "\nCapacity: " << capacity << endl;
+
+            for (const auto &replacement : graph.get_replacement_paths(start_end_nodes.first, start_end_nodes.second)) {
+                cout << "------" << endl << "Without " << replacement.origin << " -> " << replacement.destination << ": ";
+
+                if (replacement.path.empty()) {
+                    cout << "no route" << endl;
+                    continue;
+                }
+
+                for (auto it = replacement.path.begin(); it != replacement.path.end(); ++it) {
+                    if (it == --replacement.path.end())
+                        cout << *it;
+                    else
+                        cout << *it << " -> ";
+                }
+                cout << "\nCapacity: " << replacement.capacity << endl;
+            }
+
+            cout << endl;
+        }, this->graph);
+    });
+
+    scenario_options.add_option("[Scenario 1.4] Maximize the size of the group within a maximum travel duration", [this]() {
+        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+        unsigned long budget = read_value<unsigned long>("Choose the maximum duration: ", "Invalid duration", [](const unsigned long &) {
+            return true;
+        });
+
+        visit([&](auto &graph) {
+            using Weight = decltype(graph.get_flow(0));
+            Weight limit = (Weight) min<unsigned long>(budget, numeric_limits<Weight>::max());
+
+            auto [lst, capacity, duration] = graph.get_budgeted_path(start_end_nodes.first, start_end_nodes.second, limit);
+            TRACE_SPAN("output");
+
+            if (lst.empty()) {
+                cout << "\nNo path fits within that duration" << endl << endl;
+                return;
+            }
+
+            cout << endl << "Path: ";
+            for (auto it = lst.begin(); it != lst.end(); ++it) {
+                if (it == --lst.end())
+                    cout << *it;
+                else
+                    cout << *it << " -> ";
+            }
+            cout << "\nCapacity: " << capacity << "\nDuration: " << duration << endl << endl;
+        }, this->graph);
+    });
+
+    scenario_options.add_option("[Scenario 1.5] Follow the timetable to arrive the earliest, or with the biggest group by a deadline", [this]() {
+        std::pair<unsigned long, unsigned long> start_end_nodes = choose_starting_and_ending_nodes();
+
+        unsigned long time = read_value<unsigned long>("Choose the departure time: ", "Invalid time", [](const unsigned long &) {
+            return true;
+        });
+
+        unsigned long deadline = read_value<unsigned long>("Choose the deadline: ", "Invalid deadline", [time](const unsigned long &deadline) {
+            return deadline >= time;
+        });
+
+        visit([&](auto &graph) {
+            using Weight = decltype(graph.get_flow(0));
+            Weight from = (Weight) min<unsigned long>(time, numeric_limits<Weight>::max());
+            Weight until = (Weight) min<unsigned long>(deadline, numeric_limits<Weight>::max());
+
+            using Table = decltype(BasicTimetable(graph));
+            if (!holds_alternative<Table>(this->timetable)) {
+                this->timetable.emplace<Table>(graph);
+            }
+            Table &timetable = get<Table>(this->timetable);
+
+            auto print_journey = [](const auto &journey) {
+                cout << "Format: [ origin -> destination / departure - arrival / capacity ]\n";
+                for (const auto &leg : journey.legs) {
+                    cout << "[ " << leg.origin << " -> " << leg.destination << " / " << leg.departure << " - " << leg.arrival << " / " << leg.capacity << " ]\n";
+                }
+                cout << "Arrival: " << journey.arrival << "\nCapacity: " << journey.capacity << endl;
+            };
+
+            auto earliest = timetable.get_earliest_arrival(start_end_nodes.first, start_end_nodes.second, from);
+
+            cout << "\nEarliest arrival:\n";
+            if (earliest.legs.empty() && start_end_nodes.first != start_end_nodes.second) {
+                cout << "No journey reaches the destination" << endl;
+            } else {
+                print_journey(earliest);
+            }
+
+            auto widest = timetable.get_max_capacity_by_deadline(start_end_nodes.first, start_end_nodes.second, from, until);
+
+            cout << "------\nBiggest group arriving by " << deadline << ":\n";
+            if (widest.legs.empty() && start_end_nodes.first != start_end_nodes.second) {
+                cout << "No journey arrives by the deadline" << endl;
+            } else {
+                print_journey(widest);
+            }
+
+            cout << endl;
+        }, this->graph);
+    });
+
+    scenario.add_block(instrument(scenario_options));
     return scenario;
 
 }
@@ -287,7 +669,7 @@ Menu UI::get_scenario_menu() {
     scenario_options.add_option("[Scenario 1] Groups that don't separate", [this]() {
         Menu scenario_choice = get_non_separation_menu();
 
-        MenuBlock special_block;    
+        MenuBlock special_block;
         special_block.add_option("Exit", [this]() { this->is_running = false; });
 
         scenario_choice.set_special_block(special_block);
@@ -296,12 +678,14 @@ Menu UI::get_scenario_menu() {
 
     scenario_options.add_option("[Scenario 2] Groups that separate", [this]() {
             bool is_on_menu = true;
-        
-            MenuBlock special_block;    
+
+            MenuBlock special_block;
             special_block.add_option("Back", [&is_on_menu]() { is_on_menu = false; });
             special_block.add_option("Exit", [this]() { this->is_running = false; });
 
             while (this->is_running) {
+                refresh();
+
                 Menu scenario_choice = get_separation_menu();
                 scenario_choice.set_special_block(special_block);
                 scenario_choice.show();
@@ -312,24 +696,23 @@ Menu UI::get_scenario_menu() {
 
                 wait_for_input();
             }
-            
+
             this->scenario_two_executed = false;
     });
 
     scenario_options.add_option("[Options] Change the dataset file", [this](){
-        string filename = choose_file();
-        File file(filename);
-        int n = file.get_header()[0];
-
-        Graph graph{n}; 
+        string file = choose_file();
 
-        for (Edge &edge : Edge::from_file(file)) {
-            graph.add_edge(edge);
-        }
-
-        this->graph = graph;
+        datasets.add(file, file);
+        switch_to(file);
     });
 
+    if (datasets.list().size() > 1) {
+        scenario_options.add_option("[Options] Switch to another dataset", [this](){
+            switch_to(choose_dataset());
+        });
+    }
+
     scenario.add_block(scenario_options);
     return scenario;
-}
\ No newline at end of file
+}
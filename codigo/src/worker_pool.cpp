@@ -0,0 +1,209 @@
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <system_error>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "worker_pool.h"
+
+using namespace std;
+
+/**
+ * @brief Writes a whole buffer, retrying short writes
+ *
+ * @return false if the other end is gone
+ */
+static bool write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+
+        data += written;
+        length -= written;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads a whole buffer, retrying short reads
+ *
+ * @return false if the other end is gone
+ */
+static bool read_all(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t got = read(fd, data, length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+
+        data += got;
+        length -= got;
+    }
+
+    return true;
+}
+
+/** @brief Sends a string, preceded by its length */
+static bool send_message(int fd, const string &message) {
+    uint64_t length = message.size();
+    return write_all(fd, reinterpret_cast<const char *>(&length), sizeof(length)) && write_all(fd, message.data(), length);
+}
+
+/** @brief Receives a string sent by send_message */
+static bool receive_message(int fd, string &message) {
+    uint64_t length;
+    if (!read_all(fd, reinterpret_cast<char *>(&length), sizeof(length))) {
+        return false;
+    }
+
+    message.resize(length);
+    return read_all(fd, message.data(), length);
+}
+
+WorkerPool::WorkerPool(unsigned count, Handler handler) {
+    // Whatever is buffered would otherwise be written once more by each worker
+    cout.flush();
+    cerr.flush();
+
+    // Writes to a crashed worker fail instead of killing the parent
+    signal(SIGPIPE, SIG_IGN);
+
+    // Reserved up front, so that a worker just forked is always recorded
+    workers.reserve(count);
+
+    try {
+        for (unsigned i = 0; i < count; i++) {
+            int sockets[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+                throw system_error(errno, generic_category(), "socketpair");
+            }
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                int error = errno;
+                close(sockets[0]);
+                close(sockets[1]);
+                throw system_error(error, generic_category(), "fork");
+            }
+
+            if (pid == 0) {
+                // The sockets of earlier workers belong to the parent
+                for (const Worker &worker : workers) {
+                    close(worker.socket);
+                }
+                close(sockets[0]);
+
+                serve(sockets[1], handler);
+            }
+
+            close(sockets[1]);
+            workers.push_back({ pid, sockets[0] });
+        }
+    } catch (...) {
+        // The destructor won't run for a pool that was never made, so the workers forked so far are stopped here
+        for (Worker &worker : workers) {
+            stop(worker);
+        }
+        throw;
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    for (Worker &worker : workers) {
+        stop(worker);
+    }
+}
+
+void WorkerPool::serve(int socket, const Handler &handler) {
+    string request;
+
+    while (receive_message(socket, request)) {
+        if (!send_message(socket, handler(request))) {
+            break;
+        }
+    }
+
+    // Skips the destructors and exit handlers of the parent's objects, which the parent still runs itself
+    _exit(0);
+}
+
+void WorkerPool::stop(Worker &worker) {
+    if (worker.socket >= 0) {
+        close(worker.socket);
+        worker.socket = -1;
+    }
+
+    if (worker.pid > 0) {
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {}
+        worker.pid = -1;
+    }
+}
+
+vector<string> WorkerPool::run(const vector<string> &requests) {
+    vector<string> answers(requests.size());
+
+    // The request each worker is answering, or -1 if it's idle
+    vector<long> current(workers.size(), -1);
+    vector<pollfd> polled(workers.size());
+    size_t next = 0, pending = 0;
+
+    auto dispatch = [&](size_t w) {
+        while (next < requests.size() && workers[w].socket >= 0) {
+            if (send_message(workers[w].socket, requests[next])) {
+                current[w] = next++;
+                pending++;
+                return;
+            }
+
+            stop(workers[w]);
+        }
+    };
+
+    for (size_t w = 0; w < workers.size(); w++) {
+        dispatch(w);
+    }
+
+    while (pending > 0) {
+        for (size_t w = 0; w < workers.size(); w++) {
+            polled[w] = { current[w] >= 0 ? workers[w].socket : -1, POLLIN, 0 };
+        }
+
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw system_error(errno, generic_category(), "poll");
+        }
+
+        for (size_t w = 0; w < workers.size(); w++) {
+            if (current[w] < 0 || polled[w].revents == 0) {
+                continue;
+            }
+
+            // A worker that died leaves its request unanswered
+            if (!receive_message(workers[w].socket, answers[current[w]])) {
+                answers[current[w]].clear();
+                stop(workers[w]);
+            }
+
+            current[w] = -1;
+            pending--;
+            dispatch(w);
+        }
+    }
+
+    return answers;
+}
+
+vector<pid_t> WorkerPool::get_pids() const {
+    vector<pid_t> pids;
+    for (const Worker &worker : workers) {
+        pids.push_back(worker.pid);
+    }
+
+    return pids;
+}
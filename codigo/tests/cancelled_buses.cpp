@@ -0,0 +1,50 @@
+#include <iostream>
+#include <list>
+#include <tuple>
+
+#include "entities/graph.h"
+#include "planner.h"
+
+using namespace std;
+
+/**
+ * @brief Checks a condition, printing what was expected if it doesn't hold
+ *
+ * @return Whether the condition holds
+ */
+static bool check(bool condition, const char *expected) {
+    if (!condition) {
+        cerr << "expected " << expected << "\n";
+    }
+
+    return condition;
+}
+
+/**
+ * @brief Checks that cancelled buses are left out of the minimum cut, the critical buses and the group plans
+ *
+ * Two routes lead from 1 to 4, through 2 with capacity 3 and through 3 with capacity 2. Cancelling 2 -> 4 leaves
+ * only the route through 3, whose last bus is then the whole cut.
+ */
+int main() {
+    Graph graph(4);
+    graph.add_edge(Edge(1, 2, 5, 1));
+    graph.add_edge(Edge(2, 4, 3, 1));
+    graph.add_edge(Edge(1, 3, 4, 1));
+    graph.add_edge(Edge(3, 4, 2, 1));
+
+    decltype(graph.get_min_cut(1, 4)) both = { { 2, 4, 3 }, { 3, 4, 2 } }, through_3 = { { 3, 4, 2 } };
+
+    bool passed = check(graph.get_min_cut(1, 4) == both, "the cut 2 -> 4, 3 -> 4");
+
+    graph.set_active(1, false);
+
+    passed &= check(graph.get_min_cut(1, 4) == through_3, "the cut 3 -> 4 once 2 -> 4 is cancelled");
+    passed &= check(graph.get_critical_edges(1, 4) == through_3, "3 -> 4 to be the only critical bus");
+
+    GroupPlanner planner(graph);
+    planner.add_group({ 1, 4, 5 });
+    passed &= check(planner.plan_groups()[0].routed == 2, "a group of 2 to get through once 2 -> 4 is cancelled");
+
+    return passed ? 0 : 1;
+}
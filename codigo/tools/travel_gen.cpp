@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+
+#include "edge_stream.h"
+
+using namespace std;
+
+/**
+ * @brief A distribution of integers, given on the command line as kind:a[:b]
+ *
+ * fixed:a always gives a, uniform:a:b gives a to b, and geometric:a:b gives a plus a geometric value
+ * with mean b - a, so that the mean is b.
+ */
+struct Distribution {
+    enum Kind { FIXED, UNIFORM, GEOMETRIC } kind = FIXED;
+    unsigned long a = 1, b = 1;
+
+    static Distribution parse(const string &spec) {
+        Distribution distribution;
+        vector<string> parts;
+
+        istringstream stream(spec);
+        for (string part; getline(stream, part, ':');) {
+            parts.push_back(part);
+        }
+
+        if (parts.size() == 2 && parts[0] == "fixed") {
+            distribution.kind = FIXED;
+            distribution.a = distribution.b = stoul(parts[1]);
+        } else if (parts.size() == 3 && (parts[0] == "uniform" || parts[0] == "geometric")) {
+            distribution.kind = parts[0] == "uniform" ? UNIFORM : GEOMETRIC;
+            distribution.a = stoul(parts[1]);
+            distribution.b = stoul(parts[2]);
+        } else {
+            throw invalid_argument("Invalid distribution " + spec);
+        }
+
+        if (distribution.b < distribution.a) {
+            throw invalid_argument("Invalid distribution bounds " + spec);
+        }
+
+        return distribution;
+    }
+
+    unsigned long operator()(mt19937_64 &rng) const {
+        switch (kind) {
+            case UNIFORM:
+                return uniform_int_distribution<unsigned long>(a, b)(rng);
+            case GEOMETRIC:
+                return b == a ? a : a + geometric_distribution<unsigned long>(1.0 / (b - a + 1))(rng);
+            default:
+                return a;
+        }
+    }
+};
+
+/** @brief The command line options */
+struct Options {
+    unsigned long nodes = 1000;
+    unsigned long depth = 20;
+    Distribution degree = Distribution::parse("uniform:1:5");
+    Distribution capacity = Distribution::parse("uniform:1:20");
+    Distribution duration = Distribution::parse("uniform:1:30");
+    double skip = 0.1;
+    unsigned long seed = 1;
+    bool shuffle = true;
+    bool edge_file = false;
+    string output;
+};
+
+/** @brief Writes text through a large buffer, which is much faster than streams for millions of lines */
+class Writer {
+    FILE *file;
+    vector<char> buffer;
+    size_t used = 0;
+
+    public:
+        explicit Writer(FILE *file) : file(file), buffer(1 << 20) {}
+        ~Writer() { flush(); }
+
+        void flush() {
+            if (used == 0) {
+                return;
+            }
+
+            fwrite(buffer.data(), 1, used, file);
+            used = 0;
+        }
+
+        void line(unsigned long a, unsigned long b, unsigned long c, unsigned long d) {
+            if (buffer.size() - used < 100) {
+                flush();
+            }
+
+            char *out = buffer.data() + used, *end = buffer.data() + buffer.size();
+            for (unsigned long value : { a, b, c, d }) {
+                out = to_chars(out, end, value).ptr;
+                *out++ = ' ';
+            }
+            out[-1] = '\n';
+
+            used = out - buffer.data();
+        }
+};
+
+/**
+ * @brief Generates a layered DAG
+ *
+ * Node 1 is alone in the first layer and node N alone in the last, with the other nodes spread evenly over the
+ * layers in between. Every node gets an edge from some node of the layer before it, so node 1 is the only one
+ * without incoming edges, and the nodes of the last inner layer all lead to N, so N is the only one without
+ * outgoing edges. The remaining edges go to the next layer or, with the skip probability, to any later one.
+ * A node never gets two edges to the same destination.
+ *
+ * Layers are generated one at a time, so memory grows with the size of a layer and not of the graph. As they're
+ * also written in order, the nodes come out in topological order, which is what an edge file needs.
+ *
+ * @param options The command line options
+ * @param body Where the edges are written as text, unless they go to an edge file
+ * @param stream The edge file the nodes and edges are written to, nullptr for text
+ * @return The number of edges
+ */
+static unsigned long generate(const Options &options, FILE *body, EdgeStreamWriter *stream) {
+    mt19937_64 rng(options.seed);
+    Writer writer(body);
+
+    const unsigned long n = options.nodes;
+    const unsigned long inner = n - 2;
+    const unsigned long layers = inner == 0 ? 0 : min(max(options.depth, 3ul) - 2, inner);
+
+    // Ids are shuffled, so that they say nothing about the layer of a node
+    vector<unsigned long> id(n + 1);
+    for (unsigned long i = 0; i <= n; i++) {
+        id[i] = i;
+    }
+    if (options.shuffle && inner > 1) {
+        shuffle(id.begin() + 2, id.begin() + n, rng);
+    }
+
+    // Inner layer l holds the positions [first(l), first(l + 1)), layer 0 being node 1 and layer layers + 1 node N
+    auto first = [&](unsigned long l) -> unsigned long {
+        if (l == 0) return 1;
+        if (l > layers) return n;
+        return 2 + (l - 1) * inner / layers;
+    };
+    auto last = [&](unsigned long l) -> unsigned long {
+        return l > layers ? n : first(l + 1) - 1;
+    };
+
+    uniform_real_distribution<double> chance(0, 1);
+    unsigned long edges = 0;
+
+    vector<vector<unsigned long>> targets;
+    for (unsigned long l = 0; l <= layers; l++) {
+        unsigned long from = first(l), to = last(l);
+        targets.assign(to - from + 1, {});
+
+        // Every node of the next layer is reached from this one
+        for (unsigned long v = first(l + 1); v <= last(l + 1); v++) {
+            unsigned long parent = uniform_int_distribution<unsigned long>(from, to)(rng);
+            targets[parent - from].push_back(v);
+        }
+
+        for (unsigned long u = from; u <= to; u++) {
+            vector<unsigned long> &out = targets[u - from];
+            unsigned long pool = n - first(l + 1) + 1;
+            unsigned long degree = min(max(options.degree(rng), 1ul), pool);
+
+            for (unsigned long tries = 0; out.size() < degree && tries < 4 * degree; tries++) {
+                unsigned long v;
+                if (l < layers && chance(rng) < options.skip) {
+                    v = uniform_int_distribution<unsigned long>(first(l + 2), n)(rng);
+                } else {
+                    v = uniform_int_distribution<unsigned long>(first(l + 1), last(l + 1))(rng);
+                }
+
+                if (find(out.begin(), out.end(), v) == out.end()) {
+                    out.push_back(v);
+                }
+            }
+
+            if (stream) {
+                stream->add_node(id[u]);
+            }
+
+            for (unsigned long v : out) {
+                // Drawn in this order whatever the output, so that a seed gives the same graph in both
+                unsigned long duration = options.duration(rng);
+                unsigned long capacity = options.capacity(rng);
+
+                if (stream) {
+                    stream->add_edge(id[v], duration);
+                } else {
+                    writer.line(id[u], id[v], capacity, duration);
+                }
+            }
+            edges += out.size();
+        }
+    }
+
+    if (stream) {
+        stream->add_node(id[n]);
+    }
+
+    return edges;
+}
+
+/**
+ * @brief Parses the command line
+ *
+ * @return false if the options are invalid
+ */
+static bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--nodes") == 0 && has_value) {
+            options.nodes = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && has_value) {
+            options.depth = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--degree") == 0 && has_value) {
+            options.degree = Distribution::parse(argv[++i]);
+        } else if (strcmp(argv[i], "--capacity") == 0 && has_value) {
+            options.capacity = Distribution::parse(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && has_value) {
+            options.duration = Distribution::parse(argv[++i]);
+        } else if (strcmp(argv[i], "--skip") == 0 && has_value) {
+            options.skip = stod(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.seed = stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--ordered") == 0) {
+            options.shuffle = false;
+        } else if (strcmp(argv[i], "--edge-file") == 0) {
+            options.edge_file = true;
+        } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            options.output = argv[++i];
+        } else {
+            return false;
+        }
+    }
+
+    return options.nodes >= 2 && options.skip >= 0 && options.skip <= 1 && (!options.edge_file || !options.output.empty());
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    try {
+        if (!parse_options(argc, argv, options)) {
+            throw invalid_argument("Invalid option");
+        }
+    } catch (exception &e) {
+        cerr << "usage: travel_gen [--nodes n] [--depth layers] [--degree dist] [--capacity dist] [--duration dist]\n"
+             << "                  [--skip probability] [--seed n] [--ordered] [--edge-file -o file]\n"
+             << "distributions: fixed:a, uniform:a:b, geometric:min:mean\n";
+        return 1;
+    }
+
+    if (options.edge_file) {
+        try {
+            EdgeStreamWriter stream(options.output, options.nodes > UINT32_MAX, false);
+            generate(options, nullptr, &stream);
+            stream.close();
+        } catch (exception &e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // The header needs the number of edges, so the edges go to a temporary file first
+    FILE *body = tmpfile();
+    FILE *output = options.output.empty() ? stdout : fopen(options.output.c_str(), "wb");
+    if (body == nullptr || output == nullptr) {
+        cerr << "Couldn't open the output file\n";
+        return 1;
+    }
+
+    unsigned long edges = generate(options, body, nullptr);
+
+    fprintf(output, "%lu %lu\n", options.nodes, edges);
+    rewind(body);
+
+    vector<char> buffer(1 << 20);
+    for (size_t read; (read = fread(buffer.data(), 1, buffer.size(), body)) > 0;) {
+        fwrite(buffer.data(), 1, read, output);
+    }
+
+    fclose(body);
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    return 0;
+}